@@ -1,7 +1,15 @@
 #ifndef MODORGANIZER_LOOTCLI_INCLUDED
 #define MODORGANIZER_LOOTCLI_INCLUDED
 
-#include <regex>
+#include <charconv>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace lootcli
 {
@@ -15,7 +23,7 @@ enum class LogLevels
   Error
 };
 
-inline LogLevels logLevelFromString(const std::string& s)
+inline LogLevels logLevelFromString(std::string_view s)
 {
   if (s == "trace") {
     return LogLevels::Trace;
@@ -63,19 +71,81 @@ enum class Progress
   Done
 };
 
+inline std::string progressToString(Progress p)
+{
+  switch (p) {
+  case Progress::CheckingMasterlistExistence:
+    return "checkingMasterlistExistence";
+  case Progress::UpdatingMasterlist:
+    return "updatingMasterlist";
+  case Progress::LoadingLists:
+    return "loadingLists";
+  case Progress::ReadingPlugins:
+    return "readingPlugins";
+  case Progress::SortingPlugins:
+    return "sortingPlugins";
+  case Progress::WritingLoadorder:
+    return "writingLoadorder";
+  case Progress::ParsingLootMessages:
+    return "parsingLootMessages";
+  case Progress::Done:
+    return "done";
+  case Progress::None:
+  default:
+    return "none";
+  }
+}
+
 enum class MessageType
 {
   None = 0,
   Progress,
-  Log
+  Log,
+
+  // end of a request in daemon mode, carries the exit code of the run
+  Exit
 };
 
+// how far a phase is through its items, reported while the phase runs
+//
+struct ItemProgress
+{
+  std::int64_t done  = 0;
+  std::int64_t total = 0;
+
+  // size of what was processed so far, such as the plugin files read
+  std::int64_t bytes = 0;
+
+  // estimated from the throughput so far, -1 if unknown
+  std::int64_t etaMilliseconds = -1;
+};
+
+// a line of lootcli's output is one of:
+//
+//   "[progress] <phase>"
+//     a phase started, phase is the integer value of a Progress
+//
+//   "[progress] <phase> <done>/<total> <bytes> <etaMilliseconds>"
+//     progress within the phase, only written after the phase started and
+//     before the next one; consumers that only read the phase see the same
+//     phase start again
+//
+//   "[exit] <code>"
+//     end of a request in daemon mode
+//
+//   "[<level>] <text>"
+//     a log line, level is a name from logLevelToString()
+//
 struct Message
 {
   MessageType type   = MessageType::None;
   Progress progress  = Progress::None;
   LogLevels logLevel = LogLevels::Info;
   std::string log;
+  int exitCode = 0;
+
+  // for progress within a phase
+  std::optional<ItemProgress> items = std::nullopt;
 
   static Message fromProgress(Progress p)
   {
@@ -86,29 +156,824 @@ struct Message
   {
     return {MessageType::Log, Progress::None, level, std::move(log)};
   }
+
+  static Message fromExit(int code)
+  {
+    return {MessageType::Exit, Progress::None, LogLevels::Info, "", code};
+  }
+
+  static Message fromItemProgress(Progress p, const ItemProgress& items)
+  {
+    return {MessageType::Progress, p, LogLevels::Info, "", 0, items};
+  }
 };
 
-inline Message parseMessage(const std::string_view& line)
+// a message that refers to the line it was parsed from instead of owning
+// its text, see parseMessageView()
+//
+struct MessageView
+{
+  MessageType type   = MessageType::None;
+  Progress progress  = Progress::None;
+  LogLevels logLevel = LogLevels::Info;
+  std::string_view log;
+  int exitCode = 0;
+  std::optional<ItemProgress> items = std::nullopt;
+
+  Message toMessage() const
+  {
+    return {type, progress, logLevel, std::string(log), exitCode, items};
+  }
+};
+
+// parses the integer at the start of s like std::stoi(): whitespace and a
+// sign may come first and whatever follows the digits is ignored, rest is
+// set to it; returns false if there are no digits or the value doesn't fit
+//
+template <class Int>
+bool parseLeadingInt(std::string_view s, Int& out,
+                     std::string_view* rest = nullptr) noexcept
+{
+  std::size_t i = 0;
+  while (i < s.size() && (s[i] == ' ' || (s[i] >= '\t' && s[i] <= '\r'))) {
+    ++i;
+  }
+
+  // from_chars() takes a minus but not a plus
+  if (i < s.size() && s[i] == '+') {
+    ++i;
+    if (i == s.size() || s[i] == '-') {
+      return false;
+    }
+  }
+
+  const auto r = std::from_chars(s.data() + i, s.data() + s.size(), out);
+  if (r.ec != std::errc()) {
+    return false;
+  }
+
+  if (rest) {
+    *rest = s.substr(static_cast<std::size_t>(r.ptr - s.data()));
+  }
+
+  return true;
+}
+
+// parses " <done>/<total> <bytes> <etaMilliseconds>", exactly
+//
+inline std::optional<ItemProgress> parseItemProgress(std::string_view s) noexcept
+{
+  ItemProgress items;
+
+  const auto field = [&](char separator, std::int64_t& out) {
+    if (s.empty() || s[0] != separator) {
+      return false;
+    }
+
+    const auto r = std::from_chars(s.data() + 1, s.data() + s.size(), out);
+    if (r.ec != std::errc() || r.ptr == s.data() + 1) {
+      return false;
+    }
+
+    s = s.substr(static_cast<std::size_t>(r.ptr - s.data()));
+    return true;
+  };
+
+  if (field(' ', items.done) && field('/', items.total) && field(' ', items.bytes) &&
+      field(' ', items.etaMilliseconds) && s.empty()) {
+    return items;
+  }
+
+  return {};
+}
+
+// parses a line of the output of lootcli, "[type] text", without allocating;
+// the log of the returned message points into line
+//
+// type is lowercase letters and text is at least one character without line
+// breaks, anything else gives a message of type None
+//
+inline MessageView parseMessageView(std::string_view line) noexcept
 {
-  static std::regex e(R"(^\[([a-z]+)\] (.+)$)");
+  if (line.size() < 2 || line[0] != '[') {
+    return {};
+  }
 
-  std::match_results<std::string_view::const_iterator> m;
-  if (!std::regex_match(line.begin(), line.end(), m, e)) {
+  std::size_t end = 1;
+  while (end < line.size() && line[end] >= 'a' && line[end] <= 'z') {
+    ++end;
+  }
+
+  if (end == 1 || line.substr(end, 2) != "] ") {
     return {};
   }
 
-  const auto type = m[1];
+  const auto type = line.substr(1, end - 1);
+  const auto text = line.substr(end + 2);
+
+  if (text.empty() || text.find_first_of("\r\n") != std::string_view::npos) {
+    return {};
+  }
+
+  MessageView m;
 
   if (type == "progress") {
-    try {
-      const auto p = std::stoi(m[2]);
-      return Message::fromProgress(static_cast<Progress>(p));
-    } catch (std::exception&) {
+    int p = 0;
+    std::string_view rest;
+    if (!parseLeadingInt(text, p, &rest)) {
+      return {};
+    }
+
+    m.type     = MessageType::Progress;
+    m.progress = static_cast<Progress>(p);
+
+    // anything else after the phase is ignored, like std::stoi() did
+    m.items = parseItemProgress(rest);
+  } else if (type == "exit") {
+    if (!parseLeadingInt(text, m.exitCode)) {
       return {};
     }
+
+    m.type = MessageType::Exit;
+  } else {
+    m.type     = MessageType::Log;
+    m.logLevel = logLevelFromString(type);
+    m.log      = text;
+  }
+
+  return m;
+}
+
+inline Message parseMessage(const std::string_view& line)
+{
+  return parseMessageView(line).toMessage();
+}
+
+// format of the report written to the file given with --out
+//
+// all formats have the same structure:
+//
+//   root object
+//     "messages"   array of message objects, general messages from the lists
+//     "plugins"    array of plugin objects, in load order, only the plugins
+//                  that have something to report
+//     "stats"      object
+//       "loadOrderChanged"  true, the sort rewrote the load order file
+//       "lootVersion"       string
+//       "lootcliVersion"    string
+//       "phases"            array of phase objects, in the order they ran
+//       "time"              integer, milliseconds the run took
+//
+//   message object
+//     "text"  string
+//     "type"  string, "info", "warn" or "error"
+//
+//   plugin object
+//     "clean"              array of cleaning objects, known clean versions
+//     "dirty"              array of cleaning objects, known dirty versions
+//     "incompatibilities"  array of objects with "displayName" (string,
+//                          omitted when it's the name) and "name" (string),
+//                          only the plugins that are installed
+//     "isLightMaster"      true
+//     "isMaster"           true
+//     "loadsArchive"       true
+//     "messages"           array of message objects
+//     "missingMasters"     array of strings
+//     "name"               string
+//
+//   phase object, one per progress phase; a phase lasts until the next one is
+//   reported, work that overlaps with it on other threads is counted in it
+//     "counters"            object of integers by name, such as
+//                           "bytesDownloaded", "pluginsLoaded",
+//                           "lightPlugins" or "messagesReported";
+//                           "allocations" when run by lootcli_bench
+//                           built with LOOTCLI_COUNT_ALLOCATIONS
+//     "name"                string, see progressToString()
+//     "peakRssBytes"        integer, peak memory of the process at the end of
+//                           the phase
+//     "systemMicroseconds"  integer, cpu time of the process in the kernel
+//     "userMicroseconds"    integer, cpu time of the process
+//     "wallMicroseconds"    integer
+//
+//   cleaning object
+//     "cleaningUtility"    string
+//     "crc"                integer
+//     "deletedNavmesh"     integer, dirty only
+//     "deletedReferences"  integer, dirty only
+//     "info"               string
+//     "itm"                integer, dirty only
+//
+// members are omitted instead of being empty or false; readers should ignore
+// members they don't know, new ones may be added
+//
+// with --messageTable, each distinct message is written once in a
+// "messageTable" array of message objects in the root, sorted by their "id"
+// member (integer); elements of "messages" arrays and the "info" of cleaning
+// objects are then integers, the id of the message in the table
+//
+// the id of a message is derived from its type and text, so it's the same in
+// every report unless two messages hash to the same id, which is unlikely
+//
+// with --delta, a delta document in the same format is also written to the
+// output file with ".delta" appended; it has what changed since the last sort
+// of the profile that was run with --delta:
+//
+//   root object
+//     "addedPlugins"          array of plugin objects that weren't in the last
+//                             report
+//     "changedPlugins"        array of plugin objects that are different
+//     "full"                  true, there's nothing to compare with and the
+//                             whole report must be read; nothing else is
+//                             written then
+//     "messageTable"          the whole table, with --messageTable
+//     "messages"              array of message objects, all the general
+//                             messages, only when they changed
+//     "moves"                 array of move objects
+//     "removedFromLoadOrder"  array of strings, plugins that are not in the
+//                             load order anymore
+//     "removedPlugins"        array of strings, plugins that were in the last
+//                             report but aren't anymore
+//
+//   move object
+//     "index"  integer
+//     "name"   string
+//
+// the new load order is the last one without the removed plugins and the
+// moved plugins, with the moved plugins then inserted at their index in the
+// order of "moves"; new plugins are moves too
+//
+// nothing changed if there are no members but the table
+//
+// json is utf-8 and cbor (rfc 8949) is written with text strings for strings
+// and keys, indefinite length maps and arrays, and starts with the
+// self-describe tag 55799; see decodeCborReport()
+//
+enum class ReportFormat
+{
+  // indented json, the default
+  Json = 0,
+
+  // json without any whitespace
+  JsonCompact,
+
+  Cbor
+};
+
+inline std::optional<ReportFormat> reportFormatFromString(std::string_view s)
+{
+  if (s == "json") {
+    return ReportFormat::Json;
+  } else if (s == "json-compact") {
+    return ReportFormat::JsonCompact;
+  } else if (s == "cbor") {
+    return ReportFormat::Cbor;
   } else {
-    return Message::fromLog(logLevelFromString(type), m[2]);
+    return {};
+  }
+}
+
+inline std::string reportFormatToString(ReportFormat f)
+{
+  switch (f) {
+  case ReportFormat::JsonCompact:
+    return "json-compact";
+  case ReportFormat::Cbor:
+    return "cbor";
+  case ReportFormat::Json:
+  default:
+    return "json";
+  }
+}
+
+struct ReportMessage
+{
+  std::string type;
+  std::string text;
+
+  // id in the message table if the report has one, -1 otherwise; type and
+  // text are filled from the table by decodeCborReport()
+  std::int64_t tableId = -1;
+};
+
+struct ReportCleaningData
+{
+  std::int64_t crc               = 0;
+  std::int64_t itm               = 0;
+  std::int64_t deletedReferences = 0;
+  std::int64_t deletedNavmesh    = 0;
+  std::string cleaningUtility;
+  std::string info;
+
+  // same as ReportMessage::tableId, for info
+  std::int64_t infoId = -1;
+};
+
+struct ReportIncompatibility
+{
+  std::string name;
+  std::string displayName;
+};
+
+struct ReportPlugin
+{
+  std::string name;
+  std::vector<ReportIncompatibility> incompatibilities;
+  std::vector<ReportMessage> messages;
+  std::vector<ReportCleaningData> dirty;
+  std::vector<ReportCleaningData> clean;
+  std::vector<std::string> missingMasters;
+  bool loadsArchive  = false;
+  bool isMaster      = false;
+  bool isLightMaster = false;
+};
+
+struct ReportPhase
+{
+  std::string name;
+  std::int64_t wallMicroseconds   = 0;
+  std::int64_t userMicroseconds   = 0;
+  std::int64_t systemMicroseconds = 0;
+  std::int64_t peakRssBytes       = 0;
+  std::vector<std::pair<std::string, std::int64_t>> counters;
+};
+
+struct ReportStats
+{
+  std::int64_t time     = 0;
+  bool loadOrderChanged = false;
+  std::string lootcliVersion;
+  std::string lootVersion;
+  std::vector<ReportPhase> phases;
+};
+
+struct Report
+{
+  std::vector<ReportMessage> messages;
+  std::vector<ReportPlugin> plugins;
+  std::vector<ReportMessage> messageTable;
+  ReportStats stats;
+};
+
+// reads the subset of cbor used by the report: integers, strings, booleans,
+// arrays, maps and tags, which are skipped; anything else can only be skipped
+// with skip()
+//
+// every function throws std::runtime_error if the data is truncated or isn't
+// of the expected type
+//
+class CborReader
+{
+public:
+  explicit CborReader(std::string_view data) : m_data(data), m_pos(0) {}
+
+  bool atEnd() const { return m_pos >= m_data.size(); }
+
+  // whether the next item is an integer, tags are skipped
+  bool nextIsInt()
+  {
+    skipTags();
+    return !atEnd() && (static_cast<unsigned char>(m_data[m_pos]) >> 5) <= 1;
   }
+
+  std::int64_t readInt()
+  {
+    const auto h = head();
+
+    if (h.major == 0 && h.argument <= INT64_MAX) {
+      return static_cast<std::int64_t>(h.argument);
+    } else if (h.major == 1 && h.argument <= INT64_MAX) {
+      return -1 - static_cast<std::int64_t>(h.argument);
+    }
+
+    fail();
+  }
+
+  bool readBool()
+  {
+    const auto h = head();
+
+    if (h.major == 7 && (h.argument == 20 || h.argument == 21)) {
+      return (h.argument == 21);
+    }
+
+    fail();
+  }
+
+  // text or byte string
+  std::string readString()
+  {
+    const auto h = head();
+    if (h.major != 2 && h.major != 3) {
+      fail();
+    }
+
+    if (!h.indefinite) {
+      return std::string(take(h.argument));
+    }
+
+    // chunks of definite strings until a break
+    std::string s;
+    while (!readBreak()) {
+      const auto chunk = head();
+      if (chunk.major != h.major || chunk.indefinite) {
+        fail();
+      }
+
+      s += take(chunk.argument);
+    }
+
+    return s;
+  }
+
+  // calls f() for each element of an array, f() must read exactly one item
+  template <class F>
+  void readArray(F&& f)
+  {
+    readContainer(4, f);
+  }
+
+  // calls f(key) for each member of a map, f() must read exactly the value
+  template <class F>
+  void readMap(F&& f)
+  {
+    readContainer(5, [&] {
+      const auto key = readString();
+      f(key);
+    });
+  }
+
+  // skips the next item, whatever it is
+  void skip()
+  {
+    const auto h = head();
+
+    switch (h.major) {
+    case 0:
+    case 1:
+    case 7:
+      break;
+
+    case 2:
+    case 3:
+      if (h.indefinite) {
+        while (!readBreak()) {
+          skip();
+        }
+      } else {
+        take(h.argument);
+      }
+      break;
+
+    case 4:
+    case 5: {
+      const std::uint64_t items = (h.major == 5 ? 2 : 1);
+
+      if (h.indefinite) {
+        while (!readBreak()) {
+          for (std::uint64_t i = 0; i < items; ++i) {
+            skip();
+          }
+        }
+      } else {
+        for (std::uint64_t i = 0; i < h.argument * items; ++i) {
+          skip();
+        }
+      }
+      break;
+    }
+    }
+  }
+
+private:
+  struct Head
+  {
+    unsigned int major     = 0;
+    std::uint64_t argument = 0;
+    bool indefinite        = false;
+  };
+
+  std::string_view m_data;
+  std::size_t m_pos;
+
+  [[noreturn]] static void fail()
+  {
+    throw std::runtime_error("invalid cbor report");
+  }
+
+  unsigned char byte()
+  {
+    if (atEnd()) {
+      fail();
+    }
+
+    return static_cast<unsigned char>(m_data[m_pos++]);
+  }
+
+  std::string_view take(std::uint64_t size)
+  {
+    if (size > m_data.size() - m_pos) {
+      fail();
+    }
+
+    const auto s = m_data.substr(m_pos, static_cast<std::size_t>(size));
+    m_pos += static_cast<std::size_t>(size);
+
+    return s;
+  }
+
+  // consumes a break if it's next
+  bool readBreak()
+  {
+    if (!atEnd() && static_cast<unsigned char>(m_data[m_pos]) == 0xff) {
+      ++m_pos;
+      return true;
+    }
+
+    return false;
+  }
+
+  void skipTags()
+  {
+    while (!atEnd() && (static_cast<unsigned char>(m_data[m_pos]) >> 5) == 6) {
+      head();
+    }
+  }
+
+  // initial byte and argument of the next item, tags are skipped
+  Head head()
+  {
+    for (;;) {
+      const auto initial = byte();
+
+      Head h;
+      h.major          = initial >> 5;
+      const auto extra = initial & 0x1f;
+
+      if (extra < 24) {
+        h.argument = extra;
+      } else if (extra <= 27) {
+        const int bytes = 1 << (extra - 24);
+        for (int i = 0; i < bytes; ++i) {
+          h.argument = (h.argument << 8) | byte();
+        }
+      } else if (extra == 31 && h.major >= 2 && h.major <= 5) {
+        h.indefinite = true;
+      } else {
+        fail();
+      }
+
+      if (h.major != 6) {
+        return h;
+      }
+    }
+  }
+
+  template <class F>
+  void readContainer(unsigned int major, F&& f)
+  {
+    const auto h = head();
+    if (h.major != major) {
+      fail();
+    }
+
+    if (h.indefinite) {
+      while (!readBreak()) {
+        f();
+      }
+    } else {
+      for (std::uint64_t i = 0; i < h.argument; ++i) {
+        f();
+      }
+    }
+  }
+};
+
+inline ReportMessage decodeCborMessage(CborReader& r)
+{
+  ReportMessage m;
+
+  if (r.nextIsInt()) {
+    m.tableId = r.readInt();
+    return m;
+  }
+
+  r.readMap([&](const std::string& key) {
+    if (key == "type") {
+      m.type = r.readString();
+    } else if (key == "text") {
+      m.text = r.readString();
+    } else if (key == "id") {
+      m.tableId = r.readInt();
+    } else {
+      r.skip();
+    }
+  });
+
+  return m;
+}
+
+inline ReportCleaningData decodeCborCleaningData(CborReader& r)
+{
+  ReportCleaningData d;
+
+  r.readMap([&](const std::string& key) {
+    if (key == "crc") {
+      d.crc = r.readInt();
+    } else if (key == "itm") {
+      d.itm = r.readInt();
+    } else if (key == "deletedReferences") {
+      d.deletedReferences = r.readInt();
+    } else if (key == "deletedNavmesh") {
+      d.deletedNavmesh = r.readInt();
+    } else if (key == "cleaningUtility") {
+      d.cleaningUtility = r.readString();
+    } else if (key == "info") {
+      if (r.nextIsInt()) {
+        d.infoId = r.readInt();
+      } else {
+        d.info = r.readString();
+      }
+    } else {
+      r.skip();
+    }
+  });
+
+  return d;
+}
+
+inline ReportPhase decodeCborPhase(CborReader& r)
+{
+  ReportPhase p;
+
+  r.readMap([&](const std::string& key) {
+    if (key == "name") {
+      p.name = r.readString();
+    } else if (key == "wallMicroseconds") {
+      p.wallMicroseconds = r.readInt();
+    } else if (key == "userMicroseconds") {
+      p.userMicroseconds = r.readInt();
+    } else if (key == "systemMicroseconds") {
+      p.systemMicroseconds = r.readInt();
+    } else if (key == "peakRssBytes") {
+      p.peakRssBytes = r.readInt();
+    } else if (key == "counters") {
+      r.readMap([&](const std::string& name) {
+        p.counters.emplace_back(name, r.readInt());
+      });
+    } else {
+      r.skip();
+    }
+  });
+
+  return p;
+}
+
+inline ReportPlugin decodeCborPlugin(CborReader& r)
+{
+  ReportPlugin p;
+
+  r.readMap([&](const std::string& key) {
+    if (key == "name") {
+      p.name = r.readString();
+    } else if (key == "incompatibilities") {
+      r.readArray([&] {
+        ReportIncompatibility i;
+
+        r.readMap([&](const std::string& k) {
+          if (k == "name") {
+            i.name = r.readString();
+          } else if (k == "displayName") {
+            i.displayName = r.readString();
+          } else {
+            r.skip();
+          }
+        });
+
+        if (i.displayName.empty()) {
+          i.displayName = i.name;
+        }
+
+        p.incompatibilities.push_back(std::move(i));
+      });
+    } else if (key == "messages") {
+      r.readArray([&] {
+        p.messages.push_back(decodeCborMessage(r));
+      });
+    } else if (key == "dirty") {
+      r.readArray([&] {
+        p.dirty.push_back(decodeCborCleaningData(r));
+      });
+    } else if (key == "clean") {
+      r.readArray([&] {
+        p.clean.push_back(decodeCborCleaningData(r));
+      });
+    } else if (key == "missingMasters") {
+      r.readArray([&] {
+        p.missingMasters.push_back(r.readString());
+      });
+    } else if (key == "loadsArchive") {
+      p.loadsArchive = r.readBool();
+    } else if (key == "isMaster") {
+      p.isMaster = r.readBool();
+    } else if (key == "isLightMaster") {
+      p.isLightMaster = r.readBool();
+    } else {
+      r.skip();
+    }
+  });
+
+  return p;
+}
+
+// decodes a report written with --reportFormat cbor, throws
+// std::runtime_error if it's invalid
+//
+inline Report decodeCborReport(std::string_view data)
+{
+  CborReader r(data);
+  Report report;
+
+  r.readMap([&](const std::string& key) {
+    if (key == "messages") {
+      r.readArray([&] {
+        report.messages.push_back(decodeCborMessage(r));
+      });
+    } else if (key == "plugins") {
+      r.readArray([&] {
+        report.plugins.push_back(decodeCborPlugin(r));
+      });
+    } else if (key == "messageTable") {
+      r.readArray([&] {
+        report.messageTable.push_back(decodeCborMessage(r));
+      });
+    } else if (key == "stats") {
+      r.readMap([&](const std::string& k) {
+        if (k == "time") {
+          report.stats.time = r.readInt();
+        } else if (k == "loadOrderChanged") {
+          report.stats.loadOrderChanged = r.readBool();
+        } else if (k == "lootcliVersion") {
+          report.stats.lootcliVersion = r.readString();
+        } else if (k == "lootVersion") {
+          report.stats.lootVersion = r.readString();
+        } else if (k == "phases") {
+          r.readArray([&] {
+            report.stats.phases.push_back(decodeCborPhase(r));
+          });
+        } else {
+          r.skip();
+        }
+      });
+    } else {
+      r.skip();
+    }
+  });
+
+  // readers may not rely on the order of the members, ids are only resolved
+  // once the whole report has been read
+  std::unordered_map<std::int64_t, const ReportMessage*> table;
+  for (const auto& m : report.messageTable) {
+    if (m.tableId < 0 || !table.emplace(m.tableId, &m).second) {
+      throw std::runtime_error("invalid cbor report");
+    }
+  }
+
+  auto fromTable = [&](std::int64_t id) -> const ReportMessage& {
+    const auto itor = table.find(id);
+    if (itor == table.end()) {
+      throw std::runtime_error("invalid cbor report");
+    }
+
+    return *itor->second;
+  };
+
+  auto resolve = [&](std::vector<ReportMessage>& messages) {
+    for (auto& m : messages) {
+      if (m.tableId >= 0) {
+        const auto& e = fromTable(m.tableId);
+        m.type        = e.type;
+        m.text        = e.text;
+      }
+    }
+  };
+
+  auto resolveInfo = [&](std::vector<ReportCleaningData>& data) {
+    for (auto& d : data) {
+      if (d.infoId >= 0) {
+        d.info = fromTable(d.infoId).text;
+      }
+    }
+  };
+
+  resolve(report.messages);
+
+  for (auto& p : report.plugins) {
+    resolve(p.messages);
+    resolveInfo(p.dirty);
+    resolveInfo(p.clean);
+  }
+
+  return report;
 }
 
 }  // namespace lootcli
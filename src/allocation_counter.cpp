@@ -0,0 +1,101 @@
+#include "allocation_counter.h"
+
+#ifdef LOOTCLI_COUNT_ALLOCATIONS
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+
+std::atomic<std::int64_t> g_allocations = 0;
+
+void* allocate(std::size_t size)
+{
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+
+  // malloc(0) may return null
+  if (void* p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+
+  throw std::bad_alloc();
+}
+
+void* allocate(std::size_t size, std::align_val_t align)
+{
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+
+  const auto a = static_cast<std::size_t>(align);
+
+#ifdef _WIN32
+  void* p = _aligned_malloc(size == 0 ? 1 : size, a);
+#else
+  // aligned_alloc() wants a multiple of the alignment
+  void* p = std::aligned_alloc(a, ((size == 0 ? 1 : size) + a - 1) / a * a);
+#endif
+
+  if (p) {
+    return p;
+  }
+
+  throw std::bad_alloc();
+}
+
+void deallocate(void* p, std::align_val_t)
+{
+#ifdef _WIN32
+  _aligned_free(p);
+#else
+  std::free(p);
+#endif
+}
+
+}  // namespace
+
+// the array and nothrow forms call these by default
+//
+void* operator new(std::size_t size)
+{
+  return allocate(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t align)
+{
+  return allocate(size, align);
+}
+
+void operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t align) noexcept
+{
+  deallocate(p, align);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t align) noexcept
+{
+  deallocate(p, align);
+}
+#endif
+
+namespace lootcli
+{
+
+std::int64_t allocationCount()
+{
+#ifdef LOOTCLI_COUNT_ALLOCATIONS
+  return g_allocations.load(std::memory_order_relaxed);
+#else
+  return -1;
+#endif
+}
+
+}  // namespace lootcli
@@ -0,0 +1,19 @@
+#ifndef LOOTCLI_ALLOCATION_COUNTER_H
+#define LOOTCLI_ALLOCATION_COUNTER_H
+
+#include <cstdint>
+
+namespace lootcli
+{
+
+// number of times operator new was called by the process so far, from any
+// thread, or -1 if built without LOOTCLI_COUNT_ALLOCATIONS
+//
+// counting replaces the global operator new and delete, so this is only
+// built into lootcli_bench
+//
+std::int64_t allocationCount();
+
+}  // namespace lootcli
+
+#endif  // LOOTCLI_ALLOCATION_COUNTER_H
@@ -0,0 +1,89 @@
+#include "atomic_file.h"
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace lootcli
+{
+
+// flushes the file's content from the os's cache to the disk, a file that
+// can't be opened is ignored
+//
+void syncFile(const fs::path& path)
+{
+#ifdef _WIN32
+  const int fd = _wopen(path.c_str(), _O_RDWR | _O_BINARY);
+  if (fd >= 0) {
+    _commit(fd);
+    _close(fd);
+  }
+#else
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd >= 0) {
+    ::fsync(fd);
+    ::close(fd);
+  }
+#endif
+}
+
+AtomicFile::AtomicFile(fs::path path, bool sync)
+    : m_path(std::move(path)), m_tempPath(fs::path(m_path).concat(".tmp")),
+      m_sync(sync), m_committed(false)
+{
+  m_out.open(m_tempPath, std::ios::binary | std::ios::trunc);
+
+  if (!m_out) {
+    throw std::runtime_error("failed to open " + m_tempPath.string());
+  }
+}
+
+AtomicFile::~AtomicFile()
+{
+  if (!m_committed) {
+    m_out.close();
+
+    std::error_code ec;
+    fs::remove(m_tempPath, ec);
+  }
+}
+
+void AtomicFile::write(std::string_view s)
+{
+  m_out.write(s.data(), static_cast<std::streamsize>(s.size()));
+
+  if (!m_out) {
+    throw std::runtime_error("failed to write " + m_tempPath.string());
+  }
+}
+
+void AtomicFile::commit()
+{
+  m_out.close();
+
+  if (!m_out) {
+    throw std::runtime_error("failed to write " + m_tempPath.string());
+  }
+
+  if (m_sync) {
+    syncFile(m_tempPath);
+  }
+
+  fs::rename(m_tempPath, m_path);
+  m_committed = true;
+
+#ifndef _WIN32
+  // the rename itself is only durable once the folder is synced
+  if (m_sync) {
+    syncFile(m_path.has_parent_path() ? m_path.parent_path() : fs::path("."));
+  }
+#endif
+}
+
+}  // namespace lootcli
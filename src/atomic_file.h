@@ -0,0 +1,48 @@
+#ifndef LOOTCLI_ATOMIC_FILE_H
+#define LOOTCLI_ATOMIC_FILE_H
+
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+
+namespace lootcli
+{
+
+// writes a file through a temporary file next to it that only replaces the
+// file on commit(), so readers never see a partially written file and a
+// failure leaves the old one untouched
+//
+// the temporary file is removed if the object is destroyed before commit()
+//
+// with sync, the content is on disk before the file is replaced, so a crash
+// can't leave an empty file behind, at the cost of waiting for the disk
+//
+class AtomicFile
+{
+public:
+  explicit AtomicFile(std::filesystem::path path, bool sync = false);
+  ~AtomicFile();
+
+  AtomicFile(const AtomicFile&)            = delete;
+  AtomicFile& operator=(const AtomicFile&) = delete;
+
+  // throws if the write fails
+  //
+  void write(std::string_view s);
+
+  // flushes and closes the temporary file and renames it over the file;
+  // throws on failure
+  //
+  void commit();
+
+private:
+  std::filesystem::path m_path;
+  std::filesystem::path m_tempPath;
+  std::ofstream m_out;
+  bool m_sync;
+  bool m_committed;
+};
+
+}  // namespace lootcli
+
+#endif  // LOOTCLI_ATOMIC_FILE_H
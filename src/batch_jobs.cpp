@@ -0,0 +1,51 @@
+#include "batch_jobs.h"
+#include <fstream>
+#include <set>
+#include <toml++/toml.h>
+
+namespace lootcli
+{
+
+std::vector<BatchJob> readBatchJobs(const std::filesystem::path& file)
+{
+  // a stream rather than toml::parse_file() for utf-8 paths on windows
+  std::ifstream in(file);
+  if (!in.is_open()) {
+    throw std::runtime_error(file.string() + " could not be opened for parsing");
+  }
+
+  const auto t    = toml::parse(in, file.string());
+  const auto jobs = t["jobs"];
+
+  if (!jobs.is_array_of_tables()) {
+    throw std::runtime_error(file.string() + " has no [[jobs]] tables");
+  }
+
+  std::vector<BatchJob> list;
+  std::set<std::filesystem::path> outs;
+
+  for (const auto& job : *jobs.as_array()) {
+    const auto& table = *job.as_table();
+
+    const auto pluginListPath = table["pluginListPath"].value<std::string>();
+    const auto out            = table["out"].value<std::string>();
+
+    if (!pluginListPath || !out) {
+      throw std::runtime_error("job " + std::to_string(list.size() + 1) + " in " +
+                               file.string() + " needs both pluginListPath and out");
+    }
+
+    // jobs writing the same report would replace each other's
+    const auto outPath = std::filesystem::absolute(*out).lexically_normal();
+    if (!outs.insert(outPath).second) {
+      throw std::runtime_error("job " + std::to_string(list.size() + 1) + " in " +
+                               file.string() + " has the same out as another job");
+    }
+
+    list.push_back({*pluginListPath, *out});
+  }
+
+  return list;
+}
+
+}  // namespace lootcli
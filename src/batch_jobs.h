@@ -0,0 +1,33 @@
+#ifndef LOOTCLI_BATCH_JOBS_H
+#define LOOTCLI_BATCH_JOBS_H
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace lootcli
+{
+
+// one profile sorted by --batch, with the same meaning as --pluginListPath
+// and --out
+//
+struct BatchJob
+{
+  std::string pluginListPath;
+  std::string out;
+};
+
+// reads a jobs file, a toml file with one [[jobs]] table per job:
+//
+//   [[jobs]]
+//   pluginListPath = "C:/MO2/profiles/Default/loadorder.txt"
+//   out = "C:/MO2/profiles/Default/lootreport.json"
+//
+// throws if the file can't be read, a job is missing a key or two jobs have
+// the same out
+//
+std::vector<BatchJob> readBatchJobs(const std::filesystem::path& file);
+
+}  // namespace lootcli
+
+#endif  // LOOTCLI_BATCH_JOBS_H
@@ -0,0 +1,711 @@
+#include "bench.h"
+#include "corpus.h"
+#include "lootthread.h"
+#include "plugin_index.h"
+#include "regex_parser.h"
+#include <QJsonDocument>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <sstream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace lootcli
+{
+
+struct Estimate
+{
+  double median = 0;
+  double low    = 0;
+  double high   = 0;
+};
+
+// median of the samples with a confidence interval taken from the order
+// statistics around it, which doesn't assume any distribution; with few
+// samples it's the whole range
+//
+Estimate estimate(std::vector<double> samples)
+{
+  if (samples.empty()) {
+    return {};
+  }
+
+  std::sort(samples.begin(), samples.end());
+
+  const auto n = samples.size();
+
+  Estimate e;
+  e.median = (n % 2 == 1) ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+
+  // ranks of the 95% interval, from the normal approximation of the
+  // binomial distribution of the number of samples below the median
+  const auto half = 1.96 * std::sqrt(static_cast<double>(n)) / 2;
+  const auto k    = static_cast<std::size_t>(
+      std::max(0.0, std::floor(static_cast<double>(n) / 2 - half)));
+
+  e.low  = samples[k];
+  e.high = samples[n - 1 - k];
+
+  return e;
+}
+
+std::string readFile(const fs::path& path)
+{
+  std::ifstream in(path, std::ios::binary);
+  return {std::istreambuf_iterator<char>(in), {}};
+}
+
+void configure(LOOTWorker& worker, const Corpus& c, const BenchOptions& options)
+{
+  worker.setGame("skyrimse");
+  worker.setGamePath(c.gamePath.string());
+  worker.setPluginListPath((c.profilePath / "loadorder.txt").string());
+  worker.setOutput((c.profilePath / "report.json").string());
+  worker.setLootDataPath(c.lootDataPath.string());
+  worker.setLanguageCode("en");
+  worker.setLogLevel(options.logLevel);
+  worker.setLogOverflow(options.logOverflow);
+  worker.setUpdateMasterlist(false);
+  worker.setVerifyIncremental(false);
+  worker.setThreads(options.threads);
+}
+
+// sorts the corpus once with the worker and returns the wall time of the run
+// in milliseconds
+//
+double sortOnce(LOOTWorker& worker, const Corpus& c)
+{
+  // the results of the last run would be reused otherwise, they're in the
+  // worker's folder in LOOT's game folder
+  fs::remove_all(c.lootGamePath / "lootcli");
+
+  const auto start = std::chrono::steady_clock::now();
+
+  if (worker.run() != 0) {
+    throw std::runtime_error("sorting the corpus in " + c.gamePath.string() +
+                             " failed");
+  }
+
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                                   start)
+      .count();
+}
+
+// wall time of a phase of the worker's last run in milliseconds, 0 if it
+// didn't run
+//
+double phaseTime(const LOOTWorker& worker, Progress phase)
+{
+  for (const auto& p : worker.phases()) {
+    if (p.phase == phase) {
+      return static_cast<double>(p.wallMicroseconds) / 1000;
+    }
+  }
+
+  return 0;
+}
+
+// sorts the corpus once with a new worker, returns the wall time of the run
+// and adds the wall times of its phases to samples, in milliseconds
+//
+double runOnce(const Corpus& c, const BenchOptions& options,
+               std::vector<std::pair<std::string, std::vector<double>>>& samples)
+{
+  LOOTWorker worker;
+  configure(worker, c, options);
+
+  const auto wall = sortOnce(worker, c);
+
+  for (const auto& p : worker.phases()) {
+    const auto name = progressToString(p.phase);
+
+    auto itor = std::find_if(samples.begin(), samples.end(), [&](auto&& s) {
+      return s.first == name;
+    });
+
+    if (itor == samples.end()) {
+      itor = samples.insert(samples.end(), {name, {}});
+    }
+
+    itor->second.push_back(static_cast<double>(p.wallMicroseconds) / 1000);
+  }
+
+  return wall;
+}
+
+void print(std::size_t n, const std::string& what, const std::vector<double>& s,
+           const char* unit = "plugins")
+{
+  const auto e = estimate(s);
+
+  std::ostringstream ss;
+  ss << std::fixed << std::setprecision(1) << "[bench] " << n << " " << unit << ", "
+     << what << ": median " << e.median << "ms, 95% ci " << e.low << "-" << e.high
+     << "ms, " << s.size() << " runs";
+
+  std::cout << ss.str() << "\n";
+  std::cout.flush();
+}
+
+double megabytes(std::int64_t bytes)
+{
+  return static_cast<double>(bytes) / (1024 * 1024);
+}
+
+Corpus corpus(const fs::path& root, std::size_t size, const BenchOptions& options)
+{
+  CorpusOptions co;
+  co.game    = loot::GameId::tes5se;
+  co.plugins = size;
+  co.seed    = options.seed;
+
+  return generateCorpus(root / ("plugins-" + std::to_string(size)), co);
+}
+
+void benchSort(const fs::path& root, const BenchOptions& options)
+{
+  for (const auto size : options.sizes) {
+    const auto c = corpus(root, size, options);
+
+    // the first run reads the plugins from disk and the others from the os's
+    // cache, so it's not measured
+    std::vector<std::pair<std::string, std::vector<double>>> phases;
+    runOnce(c, options, phases);
+    phases.clear();
+
+    std::vector<double> totals;
+    for (int i = 0; i < options.runs; ++i) {
+      totals.push_back(runOnce(c, options, phases));
+    }
+
+    for (const auto& [name, samples] : phases) {
+      print(size, name, samples);
+    }
+
+    print(size, "total", totals);
+  }
+}
+
+// a worker parses the lists on its first run; later runs of the same worker,
+// as in daemon mode, only hash them when they were rewritten with the same
+// content, such as by a masterlist download that found no change
+//
+void benchLists(const fs::path& root, const BenchOptions& options)
+{
+  for (const auto size : options.sizes) {
+    const auto c          = corpus(root, size, options);
+    const auto masterlist = c.lootGamePath / "masterlist.yaml";
+
+    std::vector<double> parsed, reused;
+
+    for (int i = 0; i <= options.runs; ++i) {
+      LOOTWorker worker;
+      configure(worker, c, options);
+
+      sortOnce(worker, c);
+      const auto cold = phaseTime(worker, Progress::LoadingLists);
+
+      // same content, but a new modification time
+      const auto content = readFile(masterlist);
+      std::ofstream(masterlist, std::ios::binary) << content;
+
+      sortOnce(worker, c);
+
+      // the first run reads everything from disk, it's not measured
+      if (i > 0) {
+        parsed.push_back(cold);
+        reused.push_back(phaseTime(worker, Progress::LoadingLists));
+      }
+    }
+
+    print(size, "lists parsed", parsed);
+    print(size, "lists reused", reused);
+  }
+}
+
+// sorts each corpus with 1, 2, 4 and so on up to the given number of threads,
+// or the number of cores if it's 0 or 1; every run starts from the generated
+// load order and must give the same sorted load order as the others, or this
+// throws
+//
+void benchThreads(const fs::path& root, const BenchOptions& options)
+{
+  const auto maxThreads = options.threads > 1
+                              ? options.threads
+                              : std::max(1u, std::thread::hardware_concurrency());
+
+  for (const auto size : options.sizes) {
+    const auto c         = corpus(root, size, options);
+    const auto generated = readFile(c.profilePath / "plugins.txt");
+
+    std::string expected;
+
+    for (unsigned int threads = 1;; threads = std::min(threads * 2, maxThreads)) {
+      auto o    = options;
+      o.threads = threads;
+
+      std::vector<double> reports, totals;
+
+      for (int i = 0; i <= options.runs; ++i) {
+        std::ofstream(c.profilePath / "plugins.txt", std::ios::binary) << generated;
+        fs::remove(c.profilePath / "loadorder.txt");
+
+        LOOTWorker worker;
+        configure(worker, c, o);
+        const auto wall = sortOnce(worker, c);
+
+        const auto sorted = readFile(c.profilePath / "loadorder.txt");
+        if (expected.empty()) {
+          expected = sorted;
+        } else if (sorted != expected) {
+          throw std::runtime_error("the load order sorted with " +
+                                   std::to_string(threads) +
+                                   " threads differs from the one sorted with 1");
+        }
+
+        // the first run reads the plugins from disk, it's not measured
+        if (i > 0) {
+          reports.push_back(phaseTime(worker, Progress::ParsingLootMessages));
+          totals.push_back(wall);
+        }
+      }
+
+      const auto suffix = ", " + std::to_string(threads) + " threads";
+      print(size, "report" + suffix, reports);
+      print(size, "total" + suffix, totals);
+
+      if (threads == maxThreads) {
+        break;
+      }
+    }
+  }
+}
+
+// sorts a batch of profiles of each corpus on one handle and on one handle
+// per profile; profile k has the load order of the corpus without its last k
+// plugins, so every profile is a group of its own and they share almost all
+// their plugins
+//
+// with a handle per profile, each handle loads the plugins of its profiles, so
+// the shared plugins are read once per handle instead of once; this measures
+// whether sorting and writing the reports concurrently makes up for that
+//
+void benchBatch(const fs::path& root, const BenchOptions& options)
+{
+  const unsigned int profiles = options.threads > 1 ? options.threads : 4;
+
+  for (const auto size : options.sizes) {
+    const auto c         = corpus(root, size, options);
+    const auto generated = readFile(c.profilePath / "plugins.txt");
+
+    std::vector<std::string> pluginsTxts{generated};
+    for (unsigned int k = 1; k < profiles; ++k) {
+      const auto& last = pluginsTxts.back();
+      pluginsTxts.push_back(last.substr(0, last.rfind('\n', last.size() - 2) + 1));
+    }
+
+    std::vector<BatchJob> jobs;
+    for (unsigned int k = 0; k < profiles; ++k) {
+      const auto profile = c.profilePath.parent_path() / ("batch-" + std::to_string(k));
+      fs::create_directories(profile);
+      jobs.push_back({(profile / "loadorder.txt").string(),
+                      (profile / "report.json").string()});
+    }
+
+    for (const unsigned int handles : {1u, profiles}) {
+      auto o    = options;
+      o.threads = handles;
+
+      std::vector<double> reading, sorting, totals;
+
+      for (int i = 0; i <= options.runs; ++i) {
+        for (unsigned int k = 0; k < profiles; ++k) {
+          const auto profile = fs::path(jobs[k].pluginListPath).parent_path();
+          std::ofstream(profile / "plugins.txt", std::ios::binary) << pluginsTxts[k];
+          fs::remove(profile / "loadorder.txt");
+        }
+
+        LOOTWorker worker;
+        configure(worker, c, o);
+
+        const auto start = std::chrono::steady_clock::now();
+
+        if (worker.runBatch(jobs) != 0) {
+          throw std::runtime_error("sorting the batch in " + c.gamePath.string() +
+                                   " failed");
+        }
+
+        const auto wall = std::chrono::duration<double, std::milli>(
+                              std::chrono::steady_clock::now() - start)
+                              .count();
+
+        // the first run reads the plugins from disk, it's not measured
+        if (i > 0) {
+          reading.push_back(phaseTime(worker, Progress::ReadingPlugins));
+          sorting.push_back(phaseTime(worker, Progress::SortingPlugins) +
+                            phaseTime(worker, Progress::ParsingLootMessages));
+          totals.push_back(wall);
+        }
+      }
+
+      const auto suffix = ", " + std::to_string(profiles) + " profiles on " +
+                          std::to_string(handles) +
+                          (handles == 1 ? " handle" : " handles");
+
+      print(size, "reading plugins" + suffix, reading);
+      print(size, "sorting and reports" + suffix, sorting);
+      print(size, "total" + suffix, totals);
+    }
+  }
+}
+
+// times writing the report and prints the report's size and the peak memory
+// of the process before and after the report was written
+//
+// the peak is the process's, so it only says something about the largest
+// corpus sorted so far; sizes are best benchmarked in increasing order or one
+// per process
+//
+void benchReport(const fs::path& root, const BenchOptions& options)
+{
+  for (const auto size : options.sizes) {
+    const auto c = corpus(root, size, options);
+
+    std::vector<double> times;
+    std::int64_t before = 0, after = 0, allocations = -1;
+
+    for (int i = 0; i <= options.runs; ++i) {
+      LOOTWorker worker;
+      configure(worker, c, options);
+      sortOnce(worker, c);
+
+      // the first run reads the plugins from disk, it's not measured
+      if (i == 0) {
+        continue;
+      }
+
+      times.push_back(phaseTime(worker, Progress::ParsingLootMessages));
+
+      for (const auto& p : worker.phases()) {
+        if (p.phase == Progress::ParsingLootMessages) {
+          after = p.peakRssBytes;
+
+          if (auto itor = p.counters.find("allocations"); itor != p.counters.end()) {
+            allocations = itor->second;
+          }
+
+          break;
+        }
+
+        before = p.peakRssBytes;
+      }
+    }
+
+    print(size, "report", times);
+
+    const auto reportSize =
+        static_cast<std::int64_t>(fs::file_size(c.profilePath / "report.json"));
+
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(1) << "[bench] " << size
+       << " plugins, report size: " << megabytes(reportSize)
+       << "MB, peak rss: " << megabytes(before) << "MB before the report, "
+       << megabytes(after)
+       << "MB after";
+
+    if (allocations >= 0) {
+      ss << ", " << allocations << " allocations";
+    }
+
+    std::cout << ss.str() << "\n";
+    std::cout.flush();
+  }
+}
+
+// sorts each corpus once per report format and prints the size of the report
+// and how long a consumer takes to parse it: QJsonDocument for json, like MO2
+// does, and decodeCborReport() for cbor
+//
+void benchFormats(const fs::path& root, const BenchOptions& options)
+{
+  using namespace std::chrono;
+
+  for (const auto size : options.sizes) {
+    const auto c = corpus(root, size, options);
+
+    for (const auto format :
+         {ReportFormat::Json, ReportFormat::JsonCompact, ReportFormat::Cbor}) {
+      const auto name = reportFormatToString(format);
+      const auto out  = c.profilePath / ("report." + name);
+
+      LOOTWorker worker;
+      configure(worker, c, options);
+      worker.setOutput(out.string());
+      worker.setReportFormat(format);
+      sortOnce(worker, c);
+
+      const auto data = readFile(out);
+      std::vector<double> times;
+
+      for (int i = 0; i < options.runs; ++i) {
+        const auto start = steady_clock::now();
+
+        bool ok = false;
+
+        if (format == ReportFormat::Cbor) {
+          ok = !decodeCborReport(data).plugins.empty();
+        } else {
+          ok = QJsonDocument::fromJson(QByteArray::fromStdString(data)).isObject();
+        }
+
+        times.push_back(
+            duration<double, std::milli>(steady_clock::now() - start).count());
+
+        if (!ok) {
+          throw std::runtime_error("the " + name + " report in " + out.string() +
+                                   " can't be parsed");
+        }
+      }
+
+      print(size, name + " parsed", times);
+
+      std::ostringstream ss;
+      ss << std::fixed << std::setprecision(2) << "[bench] " << size << " plugins, "
+         << name << " size: " << megabytes(static_cast<std::int64_t>(data.size()))
+         << "MB";
+
+      std::cout << ss.str() << "\n";
+      std::cout.flush();
+    }
+  }
+}
+
+// looks up every plugin of each corpus and all their masters, like the report
+// does, through libloot's GetPlugin() and through a PluginIndex, including the
+// time to build the index
+//
+void benchLookups(const fs::path& root, const BenchOptions& options)
+{
+  using namespace std::chrono;
+
+  for (const auto size : options.sizes) {
+    const auto c = corpus(root, size, options);
+
+    const loot::GameSettings settings(loot::GameId::tes5se);
+    auto game = loot::CreateGameHandle(settings.Type(), c.gamePath, c.profilePath);
+
+    std::vector<fs::path> files;
+    for (const auto& e : fs::directory_iterator(
+             loot::GetDataPath(loot::GameId::tes5se, c.gamePath))) {
+      files.push_back(e.path().filename());
+    }
+
+    game->LoadPlugins(files, true);
+
+    const auto plugins = game->GetLoadedPlugins();
+
+    std::vector<std::string> names;
+    for (const auto& p : plugins) {
+      names.push_back(p->GetName());
+
+      for (auto&& m : p->GetMasters()) {
+        names.push_back(std::move(m));
+      }
+    }
+
+    std::vector<double> libloot, index;
+    std::size_t foundByLibloot = 0, foundByIndex = 0;
+
+    for (int i = 0; i < options.runs; ++i) {
+      auto start = steady_clock::now();
+
+      for (const auto& n : names) {
+        foundByLibloot += (game->GetPlugin(n) ? 1 : 0);
+      }
+
+      libloot.push_back(
+          duration<double, std::milli>(steady_clock::now() - start).count());
+
+      start = steady_clock::now();
+
+      const PluginIndex pi(plugins);
+      for (const auto& n : names) {
+        foundByIndex += (pi.contains(n) ? 1 : 0);
+      }
+
+      index.push_back(
+          duration<double, std::milli>(steady_clock::now() - start).count());
+    }
+
+    if (foundByLibloot != foundByIndex) {
+      throw std::runtime_error("the index didn't find the same plugins as libloot");
+    }
+
+    const auto what = std::to_string(names.size()) + " lookups";
+    print(size, what + " with libloot", libloot);
+    print(size, what + " with an index", index);
+  }
+}
+
+// sorts each corpus logging at the error level and at the trace level, and
+// prints how many lines trace logging wrote per second and how much longer
+// the runs took with it
+//
+void benchLogging(const fs::path& root, const BenchOptions& options)
+{
+  for (const auto size : options.sizes) {
+    const auto c = corpus(root, size, options);
+
+    std::map<loot::LogLevel, std::vector<double>> times;
+    std::uint64_t lines = 0, dropped = 0;
+
+    for (const auto level : {loot::LogLevel::error, loot::LogLevel::trace}) {
+      auto o     = options;
+      o.logLevel = level;
+
+      for (int i = 0; i <= options.runs; ++i) {
+        LOOTWorker worker;
+        configure(worker, c, o);
+
+        const auto wall = sortOnce(worker, c);
+
+        // the first run reads the plugins from disk, it's not measured
+        if (i == 0) {
+          continue;
+        }
+
+        times[level].push_back(wall);
+
+        if (level == loot::LogLevel::trace) {
+          lines   = worker.output().queued();
+          dropped = worker.output().dropped();
+        }
+      }
+    }
+
+    const auto quiet = estimate(times[loot::LogLevel::error]).median;
+    const auto trace = estimate(times[loot::LogLevel::trace]).median;
+
+    print(size, "total, error level", times[loot::LogLevel::error]);
+    print(size, "total, trace level", times[loot::LogLevel::trace]);
+
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(1) << "[bench] " << size
+       << " plugins, trace logging: " << lines << " lines, "
+       << (trace > 0 ? static_cast<double>(lines) / trace * 1000 : 0.0)
+       << " lines/s, " << dropped << " dropped, "
+       << (quiet > 0 ? (trace - quiet) / quiet * 100 : 0.0) << "% overhead";
+
+    std::cout << ss.str() << "\n";
+    std::cout.flush();
+  }
+}
+
+// lines like those of a sort at trace level: mostly log lines, with a phase
+// or item progress line now and then
+//
+std::vector<std::string> protocolLines(std::size_t count, std::uint32_t seed)
+{
+  std::mt19937 rng(seed);
+
+  const std::string levels[] = {"trace", "debug", "info", "warning"};
+
+  std::vector<std::string> lines;
+  lines.reserve(count);
+
+  for (std::size_t i = 0; i < count; ++i) {
+    const auto r = rng() % 100;
+
+    if (r < 2) {
+      lines.push_back("[progress] " + std::to_string(rng() % 10));
+    } else if (r < 10) {
+      const auto total = 1 + rng() % 4000;
+      lines.push_back("[progress] 4 " + std::to_string(rng() % total) + "/" +
+                      std::to_string(total) + " " + std::to_string(rng()) + " " +
+                      std::to_string(rng() % 60000));
+    } else {
+      lines.push_back("[" + levels[rng() % 4] + "] Loading plugin Synthetic Plugin " +
+                      std::to_string(rng() % 10000) + ".esp and evaluating " +
+                      std::to_string(rng() % 100) + " conditions");
+    }
+  }
+
+  return lines;
+}
+
+// parses every line with the function and returns the wall time in
+// milliseconds; what's parsed is added to check so it's not optimized away
+//
+template <class F>
+double parseAll(const std::vector<std::string>& lines, F&& parse, std::size_t& check)
+{
+  const auto start = std::chrono::steady_clock::now();
+
+  for (const auto& line : lines) {
+    const auto m = parse(line);
+    check += static_cast<std::size_t>(m.type) + m.log.size();
+  }
+
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                                   start)
+      .count();
+}
+
+void benchProtocol(const BenchOptions& options)
+{
+  for (const auto size : options.sizes) {
+    const auto lines = protocolLines(size, options.seed);
+
+    std::vector<double> views, messages, regex;
+    std::size_t viewCheck = 0, messageCheck = 0, regexCheck = 0;
+
+    for (int i = 0; i < options.runs; ++i) {
+      views.push_back(parseAll(lines, parseMessageView, viewCheck));
+      messages.push_back(parseAll(lines, parseMessage, messageCheck));
+      regex.push_back(parseAll(lines, tests::parseMessageWithRegex, regexCheck));
+    }
+
+    if (viewCheck != messageCheck || viewCheck != regexCheck) {
+      throw std::runtime_error("the parsers don't give the same messages");
+    }
+
+    print(size, "parseMessageView", views, "lines");
+    print(size, "parseMessage", messages, "lines");
+    print(size, "parseMessageWithRegex", regex, "lines");
+  }
+}
+
+void runBenchmark(const fs::path& root, const BenchOptions& options)
+{
+  if (options.what == "sort") {
+    benchSort(root, options);
+  } else if (options.what == "lists") {
+    benchLists(root, options);
+  } else if (options.what == "threads") {
+    benchThreads(root, options);
+  } else if (options.what == "batch") {
+    benchBatch(root, options);
+  } else if (options.what == "report") {
+    benchReport(root, options);
+  } else if (options.what == "formats") {
+    benchFormats(root, options);
+  } else if (options.what == "lookups") {
+    benchLookups(root, options);
+  } else if (options.what == "protocol") {
+    benchProtocol(options);
+  } else if (options.what == "logging") {
+    benchLogging(root, options);
+  } else {
+    throw std::runtime_error("unknown benchmark " + options.what);
+  }
+}
+
+}  // namespace lootcli
@@ -0,0 +1,67 @@
+#ifndef LOOTCLI_BENCH_H
+#define LOOTCLI_BENCH_H
+
+#include "log_sink.h"
+#include <lootcli/lootcli.h>
+#include <loot/api.h>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace lootcli
+{
+
+struct BenchOptions
+{
+  // what is measured:
+  //   "sort"     the phases of whole sorts
+  //   "lists"    loading the lists when they're parsed and when a worker that
+  //              already parsed them finds their content unchanged
+  //   "threads"  sorts with 1, 2, 4 and so on up to threads, or the number of
+  //              cores if threads is 0 or 1, checking that they all give the
+  //              same load order
+  //   "batch"    a batch of threads profiles, 4 if threads is 0 or 1, sorted
+  //              on one game handle and on one handle per profile
+  //   "report"   writing the report, with its size and the peak memory of
+  //              the process before and after it was written, and how many
+  //              allocations it made when built with LOOTCLI_COUNT_ALLOCATIONS
+  //   "formats"  the size of the report in each format and how long reading it
+  //              takes, with QJsonDocument for json
+  //   "lookups"  finding every plugin and master of the corpus through
+  //              libloot and through the report's case-folded index
+  //   "logging"  whole sorts logging at the error and trace levels, with the
+  //              lines per second and the overhead of trace logging; the
+  //              logLevel option is ignored
+  //   "protocol" parsing output lines with parseMessageView(),
+  //              parseMessage() and parseMessageWithRegex(); the sizes are
+  //              numbers of lines and no corpus is generated
+  std::string what = "sort";
+
+  // number of plugins of each corpus, benchmarked in this order
+  std::vector<std::size_t> sizes{100, 1000, 4000, 10000};
+
+  // measured runs per corpus, after one that's not measured
+  int runs = 5;
+
+  // see LOOTWorker::setThreads()
+  unsigned int threads = 1;
+
+  std::uint32_t seed = 1;
+
+  // the runs log at this level, comparing levels shows what logging costs
+  loot::LogLevel logLevel = loot::LogLevel::error;
+  LogOverflow logOverflow = LogOverflow::Block;
+};
+
+// generates a corpus of each size in root and measures what the options
+// say, printing the medians with a 95% confidence interval as "[bench] ..."
+// lines; nothing is downloaded
+//
+// throws if a run fails
+//
+void runBenchmark(const std::filesystem::path& root, const BenchOptions& options);
+
+}  // namespace lootcli
+
+#endif  // LOOTCLI_BENCH_H
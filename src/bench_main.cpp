@@ -0,0 +1,130 @@
+#include "bench.h"
+#include "corpus.h"
+#include "lootthread.h"
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <iostream>
+
+// lootcli_bench <folder> [--benchCase <case>] [--plugins <n,...>] [--runs <n>]
+//               [--threads <n>] [--seed <n>] [--logLevel <level>]
+//               [--logOverflow <overflow>]
+//
+//   benchmarks sorts of generated corpora in the folder, see BenchOptions
+//
+// lootcli_bench --generateCorpus <folder> [--plugins <n>] [--seed <n>]
+//
+//   only generates a corpus, to run lootcli against it
+
+namespace lootcli
+{
+
+// the value following "--<key>", if any
+//
+std::optional<std::string> getOption(const std::vector<std::string>& arguments,
+                                     const std::string& key)
+{
+  auto iter = std::find(arguments.begin(), arguments.end(), "--" + key);
+  if (iter == arguments.end() || (iter + 1) == arguments.end()) {
+    return {};
+  }
+
+  return *(iter + 1);
+}
+
+template <class T>
+T getOption(const std::vector<std::string>& arguments, const std::string& key, T def)
+{
+  if (const auto s = getOption(arguments, key)) {
+    return boost::lexical_cast<T>(*s);
+  }
+
+  return def;
+}
+
+// numbers of plugins separated by commas, such as "100,1000"
+//
+std::vector<std::size_t> getSizes(const std::vector<std::string>& arguments,
+                                  std::vector<std::size_t> def)
+{
+  const auto s = getOption(arguments, "plugins");
+  if (!s) {
+    return def;
+  }
+
+  std::vector<std::string> parts;
+  boost::split(parts, *s, boost::is_any_of(","));
+
+  std::vector<std::size_t> sizes;
+  for (const auto& part : parts) {
+    sizes.push_back(boost::lexical_cast<std::size_t>(part));
+  }
+
+  return sizes;
+}
+
+int generate(const std::vector<std::string>& arguments, const std::string& dir)
+{
+  CorpusOptions o;
+  o.seed = getOption<std::uint32_t>(arguments, "seed", o.seed);
+
+  const auto sizes = getSizes(arguments, {o.plugins});
+  if (sizes.size() != 1) {
+    throw std::runtime_error("--generateCorpus takes a single number of plugins");
+  }
+
+  o.plugins = sizes.front();
+
+  generateCorpus(dir, o);
+  return 0;
+}
+
+int bench(const std::vector<std::string>& arguments)
+{
+  if (const auto dir = getOption(arguments, "generateCorpus")) {
+    return generate(arguments, *dir);
+  }
+
+  if (arguments.size() < 2 || arguments[1].starts_with("--")) {
+    throw std::runtime_error("missing the folder for the corpora");
+  }
+
+  BenchOptions o;
+  o.what  = getOption<std::string>(arguments, "benchCase", o.what);
+  o.sizes = getSizes(arguments, o.sizes);
+  o.runs  = std::max(1, getOption(arguments, "runs", o.runs));
+  o.seed  = getOption<std::uint32_t>(arguments, "seed", o.seed);
+
+  const auto threads = getOption(arguments, "threads", 1);
+  o.threads          = static_cast<unsigned int>(std::max(0, threads));
+
+  if (const auto level = getOption(arguments, "logLevel")) {
+    o.logLevel = toLootLogLevel(logLevelFromString(*level));
+  }
+
+  const auto overflow = getOption<std::string>(arguments, "logOverflow", "block");
+  if (const auto lo = logOverflowFromString(overflow)) {
+    o.logOverflow = *lo;
+  } else {
+    throw std::runtime_error("invalid log overflow " + overflow);
+  }
+
+  runBenchmark(arguments[1], o);
+  return 0;
+}
+
+}  // namespace lootcli
+
+int main(int argc, char* argv[])
+{
+  setlocale(LC_ALL, "en.UTF-8");
+
+  std::vector<std::string> arguments(argv, argv + argc);
+
+  try {
+    return lootcli::bench(arguments);
+  } catch (const std::exception& e) {
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+  }
+}
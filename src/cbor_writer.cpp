@@ -0,0 +1,104 @@
+#include "cbor_writer.h"
+
+namespace lootcli
+{
+
+// initial bytes that don't carry an argument
+constexpr char CBOR_INDEFINITE_ARRAY = '\x9f';
+constexpr char CBOR_INDEFINITE_MAP   = '\xbf';
+constexpr char CBOR_BREAK            = '\xff';
+constexpr char CBOR_FALSE            = '\xf4';
+constexpr char CBOR_TRUE             = '\xf5';
+
+// tag 55799, marks the data as cbor
+constexpr std::uint64_t CBOR_SELF_DESCRIBE = 55799;
+
+CborWriter::CborWriter(std::string& out) : m_out(out)
+{}
+
+void CborWriter::beginDocument()
+{
+  head(6, CBOR_SELF_DESCRIBE);
+}
+
+void CborWriter::beginObject()
+{
+  m_out += CBOR_INDEFINITE_MAP;
+}
+
+void CborWriter::endObject()
+{
+  m_out += CBOR_BREAK;
+}
+
+void CborWriter::beginArray()
+{
+  m_out += CBOR_INDEFINITE_ARRAY;
+}
+
+void CborWriter::endArray()
+{
+  m_out += CBOR_BREAK;
+}
+
+void CborWriter::key(std::string_view name)
+{
+  value(name);
+}
+
+void CborWriter::value(std::string_view s)
+{
+  head(3, s.size());
+  m_out += s;
+}
+
+void CborWriter::value(std::int64_t i)
+{
+  if (i >= 0) {
+    head(0, static_cast<std::uint64_t>(i));
+  } else {
+    // -1 - i can't overflow, unlike -i
+    head(1, static_cast<std::uint64_t>(-1 - i));
+  }
+}
+
+void CborWriter::value(bool b)
+{
+  m_out += (b ? CBOR_TRUE : CBOR_FALSE);
+}
+
+void CborWriter::raw(std::string_view cbor)
+{
+  m_out += cbor;
+}
+
+void CborWriter::head(unsigned int major, std::uint64_t argument)
+{
+  const auto initial = static_cast<char>(major << 5);
+
+  int bytes = 0;
+
+  if (argument < 24) {
+    m_out += static_cast<char>(initial | static_cast<char>(argument));
+    return;
+  } else if (argument <= 0xff) {
+    m_out += static_cast<char>(initial | 24);
+    bytes = 1;
+  } else if (argument <= 0xffff) {
+    m_out += static_cast<char>(initial | 25);
+    bytes = 2;
+  } else if (argument <= 0xffffffff) {
+    m_out += static_cast<char>(initial | 26);
+    bytes = 4;
+  } else {
+    m_out += static_cast<char>(initial | 27);
+    bytes = 8;
+  }
+
+  // big endian
+  for (int i = bytes - 1; i >= 0; --i) {
+    m_out += static_cast<char>((argument >> (i * 8)) & 0xff);
+  }
+}
+
+}  // namespace lootcli
@@ -0,0 +1,47 @@
+#ifndef LOOTCLI_CBOR_WRITER_H
+#define LOOTCLI_CBOR_WRITER_H
+
+#include "report_writer.h"
+#include <string>
+
+namespace lootcli
+{
+
+// writes cbor (rfc 8949) as described in lootcli.h: objects and arrays have
+// an indefinite length so they can be written before their size is known,
+// strings are utf-8 text strings and a document starts with the
+// self-describe tag
+//
+class CborWriter : public ReportWriter
+{
+public:
+  explicit CborWriter(std::string& out);
+
+  void beginDocument() override;
+
+  void beginObject() override;
+  void endObject() override;
+
+  void beginArray() override;
+  void endArray() override;
+
+  void key(std::string_view name) override;
+
+  using ReportWriter::value;
+  void value(std::string_view s) override;
+  void value(std::int64_t i) override;
+  void value(bool b) override;
+
+  void raw(std::string_view cbor) override;
+
+private:
+  std::string& m_out;
+
+  // initial byte of an item with the given major type and argument, followed
+  // by the argument if it doesn't fit in the initial byte
+  void head(unsigned int major, std::uint64_t argument);
+};
+
+}  // namespace lootcli
+
+#endif  // LOOTCLI_CBOR_WRITER_H
@@ -0,0 +1,236 @@
+#include "commandline.h"
+#include "batch_jobs.h"
+#include "lootthread.h"
+#include <boost/lexical_cast.hpp>
+#include <lootcli/lootcli.h>
+
+#include <iostream>
+
+namespace lootcli
+{
+
+template <typename T>
+T getParameter(const std::vector<std::string>& arguments, const std::string& key)
+{
+  auto iter = std::find(arguments.begin(), arguments.end(), std::string("--") + key);
+  if ((iter != arguments.end()) && ((iter + 1) != arguments.end())) {
+    return boost::lexical_cast<T>(*(iter + 1));
+  } else {
+    throw std::runtime_error(std::string("argument missing " + key));
+  }
+}
+
+template <>
+bool getParameter<bool>(const std::vector<std::string>& arguments,
+                        const std::string& key)
+{
+  auto iter = std::find(arguments.begin(), arguments.end(), std::string("--") + key);
+  if (iter != arguments.end()) {
+    return true;
+  } else {
+    return false;
+  }
+}
+
+template <typename T>
+T getOptionalParameter(const std::vector<std::string>& arguments,
+                       const std::string& key, T def)
+{
+  try {
+    return getParameter<T>(arguments, key);
+  } catch (std::runtime_error&) {
+    return def;
+  }
+}
+
+loot::LogLevel getLogLevel(const std::vector<std::string>& arguments)
+{
+  const auto s     = getOptionalParameter<std::string>(arguments, "logLevel", "");
+  const auto level = lootcli::logLevelFromString(s);
+
+  return lootcli::toLootLogLevel(level);
+}
+
+// applies the options of one sort request to the worker; every option is set
+// explicitly so nothing leaks from one daemon request into the next, except
+// for the plugin list and output paths with --batch, which come from the jobs
+//
+void configureWorker(LOOTWorker& worker, const std::vector<std::string>& arguments)
+{
+  worker.setUpdateMasterlist(!getParameter<bool>(arguments, "skipUpdateMasterlist"));
+  worker.setVerifyIncremental(getParameter<bool>(arguments, "verifyIncremental"));
+  worker.setMessageTable(getParameter<bool>(arguments, "messageTable"));
+  worker.setDelta(getParameter<bool>(arguments, "delta"));
+  worker.setGame(getParameter<std::string>(arguments, "game"));
+  worker.setGamePath(getParameter<std::string>(arguments, "gamePath"));
+
+  if (!getParameter<bool>(arguments, "batch")) {
+    worker.setPluginListPath(getParameter<std::string>(arguments, "pluginListPath"));
+    worker.setOutput(getParameter<std::string>(arguments, "out"));
+  }
+
+  worker.setLogLevel(getLogLevel(arguments));
+  worker.setLanguageCode(getOptionalParameter<std::string>(arguments, "language", ""));
+  worker.setTraceFile(getOptionalParameter<std::string>(arguments, "trace", ""));
+  worker.setLootDataPath(getOptionalParameter<std::string>(arguments, "lootData", ""));
+
+  const auto threads = getOptionalParameter(arguments, "threads", 1);
+  worker.setThreads(static_cast<unsigned int>(std::max(0, threads)));
+
+  const auto overflow =
+      getOptionalParameter<std::string>(arguments, "logOverflow", "block");
+  if (const auto o = logOverflowFromString(overflow)) {
+    worker.setLogOverflow(*o);
+  } else {
+    throw std::runtime_error("invalid log overflow " + overflow);
+  }
+
+  const auto format =
+      getOptionalParameter<std::string>(arguments, "reportFormat", "json");
+  if (const auto f = reportFormatFromString(format)) {
+    worker.setReportFormat(*f);
+  } else {
+    throw std::runtime_error("invalid report format " + format);
+  }
+}
+
+// runs a sort, the sorts of a jobs file with --batch or, with --fingerprint,
+// only checks whether the last sort's results are still current
+//
+int runRequest(LOOTWorker& worker, const std::vector<std::string>& arguments)
+{
+  configureWorker(worker, arguments);
+
+  if (getParameter<bool>(arguments, "batch")) {
+    const auto jobs = readBatchJobs(getParameter<std::string>(arguments, "batch"));
+    return worker.runBatch(jobs);
+  }
+
+  if (getParameter<bool>(arguments, "fingerprint")) {
+    return worker.checkFingerprint();
+  }
+
+  return worker.run();
+}
+
+// splits a daemon request line on spaces, double quotes group an argument
+// that contains spaces, such as a path
+//
+std::vector<std::string> splitRequest(const std::string& line)
+{
+  std::vector<std::string> arguments;
+  std::string current;
+  bool quoted     = false;
+  bool hasCurrent = false;
+
+  for (const char c : line) {
+    if (c == '"') {
+      quoted     = !quoted;
+      hasCurrent = true;
+    } else if (c == ' ' && !quoted) {
+      if (hasCurrent) {
+        arguments.push_back(std::move(current));
+        current.clear();
+        hasCurrent = false;
+      }
+    } else {
+      current += c;
+      hasCurrent = true;
+    }
+  }
+
+  if (quoted) {
+    throw std::runtime_error("unterminated quote in request");
+  }
+
+  if (hasCurrent) {
+    arguments.push_back(std::move(current));
+  }
+
+  return arguments;
+}
+
+// reads one request per line from stdin, each request has the same options as
+// the command line; the output of a request is the same as a normal run and is
+// terminated by an "[exit] <code>" line
+//
+// the worker is kept alive between requests so game handles and the loaded
+// lists and plugins are reused; an empty line is ignored and "quit" or the end
+// of stdin stops the daemon
+//
+int runDaemon()
+{
+  LOOTWorker worker;
+  std::string line;
+
+  while (std::getline(std::cin, line)) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+
+    if (line.empty()) {
+      continue;
+    }
+
+    if (line == "quit") {
+      break;
+    }
+
+    int result = 1;
+
+    try {
+      result = runRequest(worker, splitRequest(line));
+    } catch (const std::exception& e) {
+      worker.output().pushAndFlush(std::string("[error] ") + e.what() + "\n");
+    }
+
+    worker.output().pushAndFlush("[exit] " + std::to_string(result) + "\n");
+  }
+
+  return 0;
+}
+
+// "lootcli prefetch" downloads the masterlists of all the games in LOOT's
+// settings, only the logging options and --lootData apply
+//
+int runPrefetch(const std::vector<std::string>& arguments)
+{
+  LOOTWorker worker;
+  worker.setLogLevel(getLogLevel(arguments));
+  worker.setTraceFile(getOptionalParameter<std::string>(arguments, "trace", ""));
+  worker.setLootDataPath(getOptionalParameter<std::string>(arguments, "lootData", ""));
+
+  const auto overflow =
+      getOptionalParameter<std::string>(arguments, "logOverflow", "block");
+  if (const auto o = logOverflowFromString(overflow)) {
+    worker.setLogOverflow(*o);
+  } else {
+    throw std::runtime_error("invalid log overflow " + overflow);
+  }
+
+  return worker.prefetchMasterlists();
+}
+
+int runCommandLine(const std::vector<std::string>& arguments)
+{
+  // design rationale: this was designed to have the actual loot stuff run in a separate
+  // thread. That turned out to be unnecessary atm.
+
+  try {
+    if (arguments.size() > 1 && arguments[1] == "prefetch") {
+      return runPrefetch(arguments);
+    }
+
+    if (getParameter<bool>(arguments, "daemon")) {
+      return runDaemon();
+    }
+
+    lootcli::LOOTWorker worker;
+    return runRequest(worker, arguments);
+  } catch (const std::exception& e) {
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+  }
+}
+
+}  // namespace lootcli
@@ -0,0 +1,17 @@
+#ifndef LOOTCLI_COMMANDLINE_H
+#define LOOTCLI_COMMANDLINE_H
+
+#include <string>
+#include <vector>
+
+namespace lootcli
+{
+
+// runs lootcli with the given arguments, the first one being the executable
+// name; returns the process exit code
+//
+int runCommandLine(const std::vector<std::string>& arguments);
+
+}  // namespace lootcli
+
+#endif  // LOOTCLI_COMMANDLINE_H
@@ -0,0 +1,513 @@
+#include "corpus.h"
+#include <boost/crc.hpp>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace lootcli
+{
+
+// written into the root of a corpus so it's only ever replaced by another one
+constexpr const char* CORPUS_MARKER = "lootcli-corpus";
+
+// new records of a plugin have object ids from here, which is also the first
+// one that's valid in a light plugin
+constexpr std::uint32_t FIRST_OBJECT_ID = 0x800;
+
+// most plugins that can be active at once, including the game's master
+constexpr std::size_t MAX_ACTIVE_FULL  = 255;
+constexpr std::size_t MAX_ACTIVE_LIGHT = 4096;
+
+struct SyntheticPlugin
+{
+  std::string name;
+  bool master = false;
+  bool light  = false;
+
+  // indices of the plugin's masters in the corpus, in the order of its header
+  std::vector<std::size_t> masters;
+
+  // number of new records
+  std::uint32_t records = 0;
+
+  // records of masters that are overridden, by plugin index and object id
+  std::set<std::pair<std::size_t, std::uint32_t>> overrides;
+
+  // crc of the file, for the cleaning data in the masterlist
+  std::uint32_t crc = 0;
+};
+
+std::string padded(std::size_t i)
+{
+  auto s = std::to_string(i);
+  return std::string(s.size() < 5 ? 5 - s.size() : 0, '0') + s;
+}
+
+void put16(std::string& out, std::uint16_t v)
+{
+  out += static_cast<char>(v & 0xff);
+  out += static_cast<char>(v >> 8);
+}
+
+void put32(std::string& out, std::uint32_t v)
+{
+  for (int i = 0; i < 4; ++i) {
+    out += static_cast<char>((v >> (i * 8)) & 0xff);
+  }
+}
+
+void putFloat(std::string& out, float f)
+{
+  std::uint32_t v = 0;
+  static_assert(sizeof(v) == sizeof(f));
+  std::memcpy(&v, &f, sizeof(v));
+  put32(out, v);
+}
+
+void putSubrecord(std::string& out, const char* type, std::string_view data)
+{
+  out.append(type, 4);
+  put16(out, static_cast<std::uint16_t>(data.size()));
+  out += data;
+}
+
+// a zero-terminated string, as in the subrecords of plugins
+std::string zstring(std::string_view s)
+{
+  std::string z(s);
+  z += '\0';
+  return z;
+}
+
+// appends the 24 bytes of a record header followed by its data
+void putRecord(std::string& out, const char* type, std::uint32_t flags,
+               std::uint32_t formId, std::string_view data)
+{
+  out.append(type, 4);
+  put32(out, static_cast<std::uint32_t>(data.size()));
+  put32(out, flags);
+  put32(out, formId);
+  put32(out, 0);   // version control
+  put16(out, 44);  // form version
+  put16(out, 0);
+  out += data;
+}
+
+// the bytes of a plugin file with a TES4 header and one group of GLOB
+// records, the new ones followed by the overrides
+//
+std::string pluginBytes(const std::vector<SyntheticPlugin>& corpus, std::size_t i,
+                        float headerVersion)
+{
+  const auto& p = corpus[i];
+
+  // the top byte of a form id is the index of the plugin that created the
+  // record in the masters of the plugin, or the number of masters for its own
+  const auto formId = [&](std::size_t plugin, std::uint32_t objectId) {
+    const auto m   = std::find(p.masters.begin(), p.masters.end(), plugin);
+    const auto top = static_cast<std::uint32_t>(m - p.masters.begin());
+    return (top << 24) | objectId;
+  };
+
+  std::string records;
+
+  const auto putGlobal = [&](std::uint32_t id, const std::string& editorId) {
+    std::string data;
+    putSubrecord(data, "EDID", zstring(editorId));
+    putSubrecord(data, "FNAM", "s");
+
+    std::string value;
+    putFloat(value, static_cast<float>(id & 0xffff));
+    putSubrecord(data, "FLTV", value);
+
+    putRecord(records, "GLOB", 0, id, data);
+  };
+
+  for (std::uint32_t r = 0; r < p.records; ++r) {
+    putGlobal(formId(i, FIRST_OBJECT_ID + r), "Synthetic" + padded(i) + "_" +
+                                                  std::to_string(r));
+  }
+
+  for (const auto& [plugin, objectId] : p.overrides) {
+    putGlobal(formId(plugin, objectId),
+              "Synthetic" + padded(plugin) + "_" +
+                  std::to_string(objectId - FIRST_OBJECT_ID));
+  }
+
+  std::string header;
+
+  {
+    std::string hedr;
+    putFloat(hedr, headerVersion);
+    put32(hedr, static_cast<std::uint32_t>(p.records + p.overrides.size()));
+    put32(hedr, FIRST_OBJECT_ID + p.records);
+    putSubrecord(header, "HEDR", hedr);
+  }
+
+  putSubrecord(header, "CNAM", zstring("lootcli"));
+
+  for (const auto m : p.masters) {
+    putSubrecord(header, "MAST", zstring(corpus[m].name));
+    putSubrecord(header, "DATA", std::string(8, '\0'));
+  }
+
+  std::uint32_t flags = 0;
+  if (p.master) {
+    flags |= 0x1;
+  }
+  if (p.light) {
+    flags |= 0x200;
+  }
+
+  std::string out;
+  putRecord(out, "TES4", flags, 0, header);
+
+  // group header: type, size including the header, label, group type and
+  // the same version fields as a record
+  out += "GRUP";
+  put32(out, static_cast<std::uint32_t>(24 + records.size()));
+  out += "GLOB";
+  put32(out, 0);
+  put32(out, 0);
+  put16(out, 44);
+  put16(out, 0);
+  out += records;
+
+  return out;
+}
+
+void writeFile(const fs::path& path, std::string_view content)
+{
+  std::ofstream out(path, std::ios::binary);
+  out.write(content.data(), static_cast<std::streamsize>(content.size()));
+  out.close();
+
+  if (!out) {
+    throw std::runtime_error("failed to write " + path.string());
+  }
+}
+
+// decides the plugins and their contents, the masters come first
+//
+std::vector<SyntheticPlugin> planCorpus(const CorpusOptions& options,
+                                        const std::string& gameMaster,
+                                        bool lightPlugins, std::mt19937& rng)
+{
+  // the distributions of the standard library differ between
+  // implementations, only the engine's output is the same everywhere
+  const auto random = [&](std::size_t n) {
+    return n > 0 ? static_cast<std::size_t>(rng() % n) : 0;
+  };
+
+  const std::size_t count   = std::max<std::size_t>(1, options.plugins);
+  const std::size_t masters = std::max<std::size_t>(1, count / 10);
+
+  std::vector<SyntheticPlugin> corpus(count);
+
+  corpus[0].name    = gameMaster;
+  corpus[0].master  = true;
+  corpus[0].records = 1024;
+
+  for (std::size_t i = 1; i < count; ++i) {
+    auto& p = corpus[i];
+
+    p.master = (i < masters);
+
+    if (p.master) {
+      p.name    = "Synthetic Master " + padded(i) + ".esm";
+      p.light   = lightPlugins && i % 4 == 0;
+      p.records = static_cast<std::uint32_t>(16 + random(48));
+    } else {
+      p.name    = "Synthetic Plugin " + padded(i) + ".esp";
+      p.light   = lightPlugins && i % 5 == 0;
+      p.records = static_cast<std::uint32_t>(4 + random(28));
+    }
+
+    // masters only ever have earlier masters, so there are no cycles and
+    // the masters load first
+    p.masters.push_back(0);
+
+    const auto candidates = std::min(i, masters) - 1;
+    const auto extra      = std::min(candidates, random(p.master ? 3 : 4));
+
+    while (p.masters.size() < extra + 1) {
+      const auto m = 1 + random(candidates);
+      if (std::find(p.masters.begin(), p.masters.end(), m) == p.masters.end()) {
+        p.masters.push_back(m);
+      }
+    }
+
+    const auto overrides = p.master ? 4 + random(12) : 8 + random(24);
+
+    for (std::size_t o = 0; o < overrides; ++o) {
+      const auto m = p.masters[random(p.masters.size())];
+      p.overrides.emplace(m, FIRST_OBJECT_ID +
+                                 static_cast<std::uint32_t>(random(corpus[m].records)));
+    }
+  }
+
+  return corpus;
+}
+
+// a single-quoted yaml scalar, names never have quotes
+std::string yamlString(std::string_view s)
+{
+  return "'" + std::string(s) + "'";
+}
+
+// the masterlist has something for most plugins, referring only to earlier
+// plugins so the rules never contradict each other
+//
+std::string masterlist(const std::vector<SyntheticPlugin>& corpus, std::mt19937& rng)
+{
+  const auto random = [&](std::size_t n) {
+    return n > 0 ? static_cast<std::size_t>(rng() % n) : 0;
+  };
+
+  const auto count       = corpus.size();
+  const auto firstLate   = count - count / 10;
+  const auto firstPlugin = static_cast<std::size_t>(
+      std::find_if(corpus.begin(), corpus.end(), [](auto&& p) { return !p.master; }) -
+      corpus.begin());
+
+  std::string s;
+
+  s += "bash_tags:\n  - Delev\n  - Relev\n  - Names\n\n";
+
+  s += "globals:\n";
+  s += "  - type: say\n";
+  s += "    content: 'This masterlist was generated by lootcli for benchmarks.'\n";
+  s += "  - type: warn\n";
+  s += "    content: 'Synthetic corpus with " + std::to_string(count) + " plugins.'\n";
+  s += "    condition: 'file(\"" + corpus[0].name + "\")'\n\n";
+
+  // masters are never in a later group than the plugins that need them
+  s += "groups:\n";
+  s += "  - name: default\n";
+  s += "  - name: late\n";
+  s += "    after:\n      - default\n\n";
+
+  s += "plugins:\n";
+
+  for (std::size_t i = 1; i < count; ++i) {
+    const auto& p = corpus[i];
+
+    const bool late = !p.master && i >= firstLate;
+
+    if (!late && random(10) < 4) {
+      continue;
+    }
+
+    s += "  - name: " + yamlString(p.name) + "\n";
+
+    if (late) {
+      s += "    group: late\n";
+    }
+
+    if (!p.master && i > firstPlugin && random(4) == 0) {
+      const auto after = firstPlugin + random(i - firstPlugin);
+      s += "    after:\n      - " + yamlString(corpus[after].name) + "\n";
+    }
+
+    if (random(6) == 0) {
+      s += "    req:\n      - " + yamlString(corpus[p.masters.back()].name) + "\n";
+    }
+
+    if (random(8) == 0) {
+      s += "    inc:\n";
+      s += "      - " + yamlString("Missing " + padded(i) + ".esp") + "\n";
+      s += "      - " + yamlString(corpus[random(i)].name) + "\n";
+    }
+
+    s += "    msg:\n";
+
+    switch (random(3)) {
+    case 0:
+      s += "      - type: say\n";
+      s += "        content: 'Note about " + p.name + ".'\n";
+      break;
+
+    case 1:
+      s += "      - type: warn\n";
+      s += "        content:\n";
+      s += "          - lang: en\n";
+      s += "            text: 'Warning about " + p.name + ".'\n";
+      s += "          - lang: de\n";
+      s += "            text: 'Warnung zu " + p.name + ".'\n";
+      s += "          - lang: fr\n";
+      s += "            text: 'Avertissement pour " + p.name + ".'\n";
+      break;
+
+    default:
+      // the same text for many plugins, like the common messages of the real
+      // masterlist
+      s += "      - type: error\n";
+      s += "        content: 'Requires a newer version of the game.'\n";
+      s += "        condition: 'active(\"" + corpus[random(i)].name + "\")'\n";
+      break;
+    }
+
+    if (random(3) == 0) {
+      s += "    tag:\n      - Delev\n      - -Relev\n";
+    }
+
+    if (random(20) == 0) {
+      s += "    dirty:\n";
+      s += "      - crc: " + std::to_string(p.crc) + "\n";
+      s += "        util: 'SSEEdit v4.1.5'\n";
+      s += "        itm: " + std::to_string(1 + random(20)) + "\n";
+      s += "        udr: " + std::to_string(random(4)) + "\n";
+      s += "        nav: 0\n";
+      s += "        detail: 'Clean with " + p.name + " as the last plugin.'\n";
+    } else if (random(20) == 0) {
+      s += "    clean:\n";
+      s += "      - crc: " + std::to_string(p.crc) + "\n";
+      s += "        util: 'SSEEdit v4.1.5'\n";
+    }
+  }
+
+  if (s.ends_with("plugins:\n")) {
+    // libloot wants a list, not null
+    s.replace(s.size() - 1, 1, " []\n");
+  }
+
+  return s;
+}
+
+// a few rules of a user, like load after rules and notes
+//
+std::string userlist(const std::vector<SyntheticPlugin>& corpus, std::mt19937& rng)
+{
+  const auto random = [&](std::size_t n) {
+    return n > 0 ? static_cast<std::size_t>(rng() % n) : 0;
+  };
+
+  std::string s = "plugins:\n";
+
+  for (std::size_t i = 1; i < corpus.size(); ++i) {
+    if (corpus[i].master || corpus[i - 1].master || random(50) != 0) {
+      continue;
+    }
+
+    s += "  - name: " + yamlString(corpus[i].name) + "\n";
+    s += "    after:\n      - " + yamlString(corpus[i - 1].name) + "\n";
+    s += "    msg:\n";
+    s += "      - type: say\n";
+    s += "        content: 'Moved after " + corpus[i - 1].name + " by the user.'\n";
+  }
+
+  if (s.ends_with("plugins:\n")) {
+    // libloot wants a list, not null
+    s.replace(s.size() - 1, 1, " []\n");
+  }
+
+  return s;
+}
+
+// the load order: the masters in order followed by the other plugins
+// shuffled, with as many active as the game allows
+//
+std::string pluginsTxt(const std::vector<SyntheticPlugin>& corpus, std::mt19937& rng)
+{
+  std::vector<std::size_t> order;
+  for (std::size_t i = 1; i < corpus.size(); ++i) {
+    order.push_back(i);
+  }
+
+  const auto firstPlugin = std::find_if(order.begin(), order.end(), [&](auto i) {
+    return !corpus[i].master;
+  });
+
+  for (auto i = order.end() - firstPlugin; i > 1; --i) {
+    std::swap(firstPlugin[i - 1], firstPlugin[rng() % static_cast<std::uint32_t>(i)]);
+  }
+
+  // the game's master is always active and isn't listed
+  std::size_t full  = 1;
+  std::size_t light = 0;
+
+  std::string s;
+
+  for (const auto i : order) {
+    auto& n = corpus[i].light ? light : full;
+    if (n < (corpus[i].light ? MAX_ACTIVE_LIGHT : MAX_ACTIVE_FULL)) {
+      s += '*';
+      ++n;
+    }
+
+    s += corpus[i].name + "\r\n";
+  }
+
+  return s;
+}
+
+Corpus generateCorpus(const fs::path& root, const CorpusOptions& options)
+{
+  switch (options.game) {
+  case loot::GameId::tes5se:
+  case loot::GameId::tes5vr:
+  case loot::GameId::enderalse:
+  case loot::GameId::fo4:
+  case loot::GameId::fo4vr:
+    break;
+
+  default:
+    throw std::runtime_error("corpus generation is not supported for " +
+                             loot::ToString(options.game));
+  }
+
+  if (fs::exists(root)) {
+    if (!fs::is_empty(root) && !fs::exists(root / CORPUS_MARKER)) {
+      throw std::runtime_error(root.string() +
+                               " is not empty and is not a generated corpus");
+    }
+
+    fs::remove_all(root);
+  }
+
+  const loot::GameSettings settings(options.game, loot::ToString(options.game));
+
+  Corpus c;
+  c.gamePath     = root / "game";
+  c.profilePath  = root / "profile";
+  c.lootDataPath = root / "loot";
+  c.lootGamePath = c.lootDataPath / "games" / settings.FolderName();
+
+  const auto dataPath = loot::GetDataPath(options.game, c.gamePath);
+
+  fs::create_directories(dataPath);
+  fs::create_directories(c.profilePath);
+  fs::create_directories(c.lootGamePath);
+  writeFile(root / CORPUS_MARKER, "");
+
+  std::mt19937 rng(options.seed);
+
+  auto corpus =
+      planCorpus(options, settings.Master(),
+                 loot::SupportsLightPlugins(settings.Type()), rng);
+
+  for (std::size_t i = 0; i < corpus.size(); ++i) {
+    const auto bytes = pluginBytes(corpus, i, settings.MinimumHeaderVersion());
+
+    boost::crc_32_type crc;
+    crc.process_bytes(bytes.data(), bytes.size());
+    corpus[i].crc = crc.checksum();
+
+    writeFile(dataPath / corpus[i].name, bytes);
+  }
+
+  writeFile(c.profilePath / "plugins.txt", pluginsTxt(corpus, rng));
+  writeFile(c.lootGamePath / "masterlist.yaml", masterlist(corpus, rng));
+  writeFile(c.lootGamePath / "userlist.yaml", userlist(corpus, rng));
+
+  return c;
+}
+
+}  // namespace lootcli
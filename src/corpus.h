@@ -0,0 +1,55 @@
+#ifndef LOOTCLI_CORPUS_H
+#define LOOTCLI_CORPUS_H
+
+#include "game_settings.h"
+#include <cstdint>
+#include <filesystem>
+
+namespace lootcli
+{
+
+struct CorpusOptions
+{
+  loot::GameId game = loot::GameId::tes5se;
+
+  // including the game's master file
+  std::size_t plugins = 1000;
+
+  // the same seed gives the same corpus on every platform
+  std::uint32_t seed = 1;
+};
+
+// where the parts of a generated corpus are
+//
+struct Corpus
+{
+  // the game's folder, the plugins are in its data folder
+  std::filesystem::path gamePath;
+
+  // a profile with the plugins.txt of the load order, like mod organizer's
+  std::filesystem::path profilePath;
+
+  // used instead of LOOT's data folder, has the masterlist and userlist
+  std::filesystem::path lootDataPath;
+
+  // the folder of the game in lootDataPath
+  std::filesystem::path lootGamePath;
+};
+
+// writes a game install with synthetic plugins into root, along with a load
+// order and a masterlist and userlist for them, so lootcli can be run offline
+// against any number of plugins
+//
+// the plugins have valid headers, masters, master and light flags, and
+// records that override those of their masters so plugins overlap; the lists
+// have messages, conditions, groups, load after rules, tags and cleaning data
+// matching the plugins' crcs
+//
+// only games whose load order is a plugins.txt with asterisks are supported;
+// root must be empty or a corpus generated earlier, which is replaced
+//
+Corpus generateCorpus(const std::filesystem::path& root, const CorpusOptions& options);
+
+}  // namespace lootcli
+
+#endif  // LOOTCLI_CORPUS_H
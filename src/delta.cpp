@@ -0,0 +1,177 @@
+#include "delta.h"
+#include "atomic_file.h"
+#include <algorithm>
+#include <fstream>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+namespace lootcli
+{
+
+// the file is the tag on the first line, then the load order as a count
+// followed by one name per line, the entries as a count followed by a name
+// and a byte count per line, each followed by the bytes of the entry, and the
+// general messages as a byte count followed by the bytes
+
+constexpr std::string_view DELTA_MAGIC = "lootcli-delta 1 ";
+
+bool readCount(std::istream& in, std::size_t& n)
+{
+  std::string line;
+  if (!std::getline(in, line)) {
+    return false;
+  }
+
+  try {
+    std::size_t end = 0;
+    n               = std::stoull(line, &end);
+    return end == line.size();
+  } catch (std::exception&) {
+    return false;
+  }
+}
+
+bool readBytes(std::istream& in, std::size_t n, std::string& s)
+{
+  s.resize(n);
+  return static_cast<bool>(in.read(s.data(), static_cast<std::streamsize>(n)));
+}
+
+std::optional<DeltaState> readDeltaState(const fs::path& file, std::string_view tag)
+{
+  std::ifstream in(file, std::ios::binary);
+  if (!in) {
+    return {};
+  }
+
+  std::string line;
+  if (!std::getline(in, line) || line.size() != DELTA_MAGIC.size() + tag.size() ||
+      !line.starts_with(DELTA_MAGIC) || !line.ends_with(tag)) {
+    return {};
+  }
+
+  DeltaState s;
+  std::size_t n = 0;
+
+  if (!readCount(in, n)) {
+    return {};
+  }
+
+  for (std::size_t i = 0; i < n; ++i) {
+    if (!std::getline(in, line)) {
+      return {};
+    }
+
+    s.order.push_back(std::move(line));
+  }
+
+  if (!readCount(in, n)) {
+    return {};
+  }
+
+  for (std::size_t i = 0; i < n; ++i) {
+    std::string name, entry;
+    std::size_t size = 0;
+
+    if (!std::getline(in, name) || !readCount(in, size) ||
+        !readBytes(in, size, entry)) {
+      return {};
+    }
+
+    s.entries.emplace_back(std::move(name), std::move(entry));
+  }
+
+  if (!readCount(in, n) || !readBytes(in, n, s.messages)) {
+    return {};
+  }
+
+  return s;
+}
+
+void writeDeltaState(const fs::path& file, std::string_view tag,
+                     const DeltaState& state)
+{
+  std::string s;
+
+  s += DELTA_MAGIC;
+  s += tag;
+  s += "\n" + std::to_string(state.order.size()) + "\n";
+
+  for (const auto& name : state.order) {
+    s += name + "\n";
+  }
+
+  s += std::to_string(state.entries.size()) + "\n";
+
+  for (const auto& [name, entry] : state.entries) {
+    s += name + "\n" + std::to_string(entry.size()) + "\n";
+    s += entry;
+  }
+
+  s += std::to_string(state.messages.size()) + "\n";
+  s += state.messages;
+
+  AtomicFile f(file);
+  f.write(s);
+  f.commit();
+}
+
+std::vector<LoadOrderMove> loadOrderMoves(const std::vector<std::string>& before,
+                                          const std::vector<std::string>& after)
+{
+  std::unordered_map<std::string_view, std::size_t> positions;
+  for (std::size_t i = 0; i < before.size(); ++i) {
+    positions.emplace(before[i], i);
+  }
+
+  // for each plugin of after that's also in before, its index in after and
+  // its position in before
+  std::vector<std::pair<std::size_t, std::size_t>> common;
+  for (std::size_t i = 0; i < after.size(); ++i) {
+    if (const auto itor = positions.find(after[i]); itor != positions.end()) {
+      common.emplace_back(i, itor->second);
+    }
+  }
+
+  // patience sorting: tails[k] is the element of common ending the increasing
+  // subsequence of length k + 1 with the lowest position, previous[] links
+  // each element to the one before it in its subsequence
+  std::vector<std::size_t> tails;
+  std::vector<std::size_t> previous(common.size());
+
+  for (std::size_t i = 0; i < common.size(); ++i) {
+    const auto itor =
+        std::lower_bound(tails.begin(), tails.end(), common[i].second,
+                         [&](std::size_t t, std::size_t position) {
+                           return common[t].second < position;
+                         });
+
+    previous[i] = (itor == tails.begin()) ? common.size() : *(itor - 1);
+
+    if (itor == tails.end()) {
+      tails.push_back(i);
+    } else {
+      *itor = i;
+    }
+  }
+
+  std::vector<bool> kept(after.size(), false);
+
+  if (!tails.empty()) {
+    for (auto i = tails.back(); i < common.size(); i = previous[i]) {
+      kept[common[i].first] = true;
+    }
+  }
+
+  std::vector<LoadOrderMove> moves;
+  for (std::size_t i = 0; i < after.size(); ++i) {
+    if (!kept[i]) {
+      moves.push_back({after[i], i});
+    }
+  }
+
+  return moves;
+}
+
+}  // namespace lootcli
@@ -0,0 +1,62 @@
+#ifndef LOOTCLI_DELTA_H
+#define LOOTCLI_DELTA_H
+
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace lootcli
+{
+
+// what a sort with --delta keeps for the next one to compare with
+//
+struct DeltaState
+{
+  // sorted load order
+  std::vector<std::string> order;
+
+  // report entries of the plugins that have one, in load order, as written
+  // in the report
+  std::vector<std::pair<std::string, std::string>> entries;
+
+  // type and text of each general message that was reported
+  std::string messages;
+};
+
+// returns nothing if the file doesn't exist, is invalid or was written with
+// another tag, which identifies how the entries were written
+//
+std::optional<DeltaState> readDeltaState(const std::filesystem::path& file,
+                                         std::string_view tag);
+
+// throws on failure
+//
+void writeDeltaState(const std::filesystem::path& file, std::string_view tag,
+                     const DeltaState& state);
+
+// a plugin is taken out of the load order and inserted at index
+//
+struct LoadOrderMove
+{
+  std::string name;
+  std::size_t index = 0;
+};
+
+// moves that turn before into after: once the plugins that are not in after
+// and the moved plugins are taken out of before, inserting the moved plugins
+// in the order returned gives after; plugins that are not in before are moved
+// from nowhere
+//
+// the plugins that keep their relative order are a longest increasing
+// subsequence of their positions in before, so no list has fewer moves
+//
+std::vector<LoadOrderMove> loadOrderMoves(const std::vector<std::string>& before,
+                                          const std::vector<std::string>& after);
+
+}  // namespace lootcli
+
+#endif  // LOOTCLI_DELTA_H
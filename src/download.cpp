@@ -0,0 +1,647 @@
+#include "download.h"
+#include "atomic_file.h"
+#include <boost/algorithm/string.hpp>
+#include <toml++/toml.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace lootcli
+{
+
+std::int64_t secondsSinceEpoch()
+{
+  return std::chrono::duration_cast<std::chrono::seconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+bool sameContent(const fs::path& a, const fs::path& b)
+{
+  std::error_code ec;
+  if (fs::file_size(a, ec) != fs::file_size(b, ec) || ec) {
+    return false;
+  }
+
+  std::ifstream fa(a, std::ios::binary);
+  std::ifstream fb(b, std::ios::binary);
+  if (!fa || !fb) {
+    return false;
+  }
+
+  std::vector<char> ba(64 * 1024);
+  std::vector<char> bb(64 * 1024);
+
+  while (fa && fb) {
+    fa.read(ba.data(), static_cast<std::streamsize>(ba.size()));
+    fb.read(bb.data(), static_cast<std::streamsize>(bb.size()));
+
+    if (fa.gcount() != fb.gcount() ||
+        !std::equal(ba.begin(), ba.begin() + fa.gcount(), bb.begin())) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+std::string toString(DownloadResult r)
+{
+  switch (r) {
+  case DownloadResult::Fresh:
+    return "fresh";
+  case DownloadResult::NotModified:
+    return "not modified";
+  case DownloadResult::Unchanged:
+    return "unchanged";
+  case DownloadResult::Updated:
+    return "updated";
+  default:
+    return "unknown";
+  }
+}
+
+std::string toString(const DownloadStats& s)
+{
+  std::string text = std::to_string(s.bytesOnWire) + " bytes on the wire, " +
+                     std::to_string(s.bytesDecoded) + " bytes decoded";
+
+  if (!s.httpVersion.empty()) {
+    text += ", HTTP/" + s.httpVersion;
+  }
+
+  if (s.connectionReused) {
+    text += ", reused connection";
+  } else {
+    text += ", TLS handshake " + std::to_string(s.handshakeMicroseconds / 1000) + "ms";
+  }
+
+  return text;
+}
+
+fs::path CacheValidators::sidecarPath(const fs::path& file)
+{
+  return fs::path(file).concat(".cache.toml");
+}
+
+CacheValidators CacheValidators::load(const fs::path& file)
+{
+  CacheValidators v;
+
+  std::ifstream in(sidecarPath(file));
+  if (!in.is_open()) {
+    return v;
+  }
+
+  try {
+    const auto t   = toml::parse(in, sidecarPath(file).string());
+    v.url          = t["url"].value_or(std::string());
+    v.etag         = t["etag"].value_or(std::string());
+    v.lastModified = t["lastModified"].value_or(std::string());
+    v.expires      = t["expires"].value_or(std::int64_t(0));
+  } catch (std::exception&) {
+    // an invalid sidecar only means the next download is unconditional
+    return {};
+  }
+
+  return v;
+}
+
+void CacheValidators::save(const fs::path& file) const
+{
+  toml::table t;
+  t.insert_or_assign("url", url);
+  t.insert_or_assign("etag", etag);
+  t.insert_or_assign("lastModified", lastModified);
+  t.insert_or_assign("expires", expires);
+
+  std::ostringstream ss;
+  ss << t << "\n";
+
+  AtomicFile out(sidecarPath(file));
+  out.write(ss.str());
+  out.commit();
+}
+
+FileDownload::FileDownload(std::string url, fs::path path)
+    : m_url(std::move(url)), m_path(std::move(path)),
+      m_tempPath(fs::path(m_path).concat(".download")), m_maxAge(-1), m_age(0),
+      m_noCache(false), m_file(nullptr), m_headers(nullptr)
+{
+  // validators only apply to the file they were received with
+  if (fs::exists(m_path)) {
+    m_old = CacheValidators::load(m_path);
+
+    if (m_old.url != m_url) {
+      m_old = {};
+    }
+  }
+}
+
+FileDownload::~FileDownload()
+{
+  closeFile();
+
+  if (m_headers) {
+    curl_slist_free_all(m_headers);
+  }
+
+  std::error_code ec;
+  fs::remove(m_tempPath, ec);
+}
+
+const std::string& FileDownload::url() const
+{
+  return m_url;
+}
+
+const fs::path& FileDownload::path() const
+{
+  return m_path;
+}
+
+bool FileDownload::isFresh() const
+{
+  return !m_old.url.empty() && m_old.expires > secondsSinceEpoch();
+}
+
+void FileDownload::setup(CURL* curl)
+{
+  m_file = fopen(m_tempPath.string().c_str(), "wb");
+  if (!m_file) {
+    throw std::runtime_error("Failed to open output file: " + m_tempPath.string());
+  }
+
+  if (!m_old.etag.empty()) {
+    m_headers = curl_slist_append(m_headers, ("If-None-Match: " + m_old.etag).c_str());
+  }
+
+  if (!m_old.lastModified.empty()) {
+    m_headers = curl_slist_append(
+        m_headers, ("If-Modified-Since: " + m_old.lastModified).c_str());
+  }
+
+  curl_easy_setopt(curl, CURLOPT_URL, m_url.c_str());
+  curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &FileDownload::onWrite);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, this);
+  curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, &FileDownload::onHeader);
+  curl_easy_setopt(curl, CURLOPT_HEADERDATA, this);
+  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, m_headers);
+  curl_easy_setopt(curl, CURLOPT_USERAGENT, "lootcli/1.5.0");
+}
+
+DownloadResult FileDownload::finish(CURL* curl, CURLcode code)
+{
+  closeFile();
+
+  curl_off_t body = 0, connect = 0, appConnect = 0;
+  long headers = 0, version = 0, connects = 0;
+
+  curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &body);
+  curl_easy_getinfo(curl, CURLINFO_HEADER_SIZE, &headers);
+  curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &connect);
+  curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &appConnect);
+  curl_easy_getinfo(curl, CURLINFO_HTTP_VERSION, &version);
+  curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
+
+  m_stats.bytesOnWire           = body + headers;
+  m_stats.handshakeMicroseconds = appConnect > connect ? appConnect - connect : 0;
+  m_stats.connectionReused      = (connects == 0);
+
+  switch (version) {
+  case CURL_HTTP_VERSION_1_0:
+    m_stats.httpVersion = "1.0";
+    break;
+  case CURL_HTTP_VERSION_1_1:
+    m_stats.httpVersion = "1.1";
+    break;
+  case CURL_HTTP_VERSION_2_0:
+    m_stats.httpVersion = "2";
+    break;
+  case CURL_HTTP_VERSION_3:
+    m_stats.httpVersion = "3";
+    break;
+  }
+
+  if (code != CURLE_OK) {
+    throw std::runtime_error(std::string("curl error: ") + curl_easy_strerror(code));
+  }
+
+  long responseCode = 0;
+  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &responseCode);
+
+  if (responseCode != 200 && responseCode != 304) {
+    throw std::runtime_error("Download failed with code " +
+                             std::to_string(responseCode));
+  }
+
+  m_new.url     = m_url;
+  m_new.expires = (m_noCache || m_maxAge - m_age <= 0)
+                      ? 0
+                      : secondsSinceEpoch() + m_maxAge - m_age;
+
+  DownloadResult result;
+
+  if (responseCode == 304) {
+    // a 304 may omit the validators, the old ones are still valid then
+    if (m_new.etag.empty()) {
+      m_new.etag = m_old.etag;
+    }
+
+    if (m_new.lastModified.empty()) {
+      m_new.lastModified = m_old.lastModified;
+    }
+
+    result = DownloadResult::NotModified;
+  } else if (sameContent(m_tempPath, m_path)) {
+    result = DownloadResult::Unchanged;
+  } else {
+    // the old validators must not be sent for the new file if saving the new
+    // ones fails below
+    std::error_code ec;
+    fs::remove(CacheValidators::sidecarPath(m_path), ec);
+    if (ec) {
+      throw std::runtime_error("Failed to remove " +
+                               CacheValidators::sidecarPath(m_path).string() + ": " +
+                               ec.message());
+    }
+
+    fs::rename(m_tempPath, m_path);
+    result = DownloadResult::Updated;
+  }
+
+  try {
+    m_new.save(m_path);
+  } catch (const std::exception& e) {
+    // the file is still good, the next download just won't be conditional
+    m_stats.validatorsError = e.what();
+  }
+
+  return result;
+}
+
+const DownloadStats& FileDownload::stats() const
+{
+  return m_stats;
+}
+
+size_t FileDownload::onWrite(char* buffer, size_t size, size_t count, void* self)
+{
+  auto* d = static_cast<FileDownload*>(self);
+
+  const auto written = fwrite(buffer, size, count, d->m_file);
+  d->m_stats.bytesDecoded += static_cast<std::int64_t>(written * size);
+
+  return written * size;
+}
+
+size_t FileDownload::onHeader(char* buffer, size_t size, size_t count, void* self)
+{
+  static_cast<FileDownload*>(self)->parseHeader({buffer, size * count});
+  return size * count;
+}
+
+void FileDownload::parseHeader(std::string_view line)
+{
+  if (line.starts_with("HTTP/")) {
+    // status line of a new response, such as after a redirect
+    m_new     = {};
+    m_maxAge  = -1;
+    m_age     = 0;
+    m_noCache = false;
+    return;
+  }
+
+  const auto colon = line.find(':');
+  if (colon == std::string_view::npos) {
+    return;
+  }
+
+  const auto name  = boost::trim_copy(std::string(line.substr(0, colon)));
+  const auto value = boost::trim_copy(std::string(line.substr(colon + 1)));
+
+  if (boost::iequals(name, "ETag")) {
+    m_new.etag = value;
+  } else if (boost::iequals(name, "Last-Modified")) {
+    m_new.lastModified = value;
+  } else if (boost::iequals(name, "Cache-Control")) {
+    std::vector<std::string> directives;
+    boost::split(directives, value, boost::is_any_of(","));
+
+    for (auto& d : directives) {
+      boost::trim(d);
+
+      if (boost::istarts_with(d, "max-age=")) {
+        try {
+          m_maxAge = std::stoll(d.substr(8));
+        } catch (std::exception&) {
+          m_maxAge = -1;
+        }
+      } else if (boost::iequals(d, "no-cache") || boost::iequals(d, "no-store")) {
+        m_noCache = true;
+      }
+    }
+  } else if (boost::iequals(name, "Age")) {
+    // time the response already spent in a proxy cache
+    try {
+      m_age = std::stoll(value);
+    } catch (std::exception&) {
+      m_age = 0;
+    }
+  }
+}
+
+void FileDownload::closeFile()
+{
+  if (m_file) {
+    fclose(m_file);
+    m_file = nullptr;
+  }
+}
+
+DownloadSession::DownloadSession(fs::path sessionStore)
+    : m_sessionStore(std::move(sessionStore)), m_share(nullptr), m_curl(nullptr)
+{
+  curl_global_init(CURL_GLOBAL_DEFAULT);
+
+  m_share = curl_share_init();
+  m_curl  = curl_easy_init();
+
+  if (!m_share || !m_curl) {
+    curl_easy_cleanup(m_curl);
+    curl_share_cleanup(m_share);
+    curl_global_cleanup();
+    throw std::runtime_error("Failed to initialize curl");
+  }
+
+  curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+  curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+  curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+
+  // also when there are no sessions to import, so the first run shares too
+  curl_easy_setopt(m_curl, CURLOPT_SHARE, m_share);
+
+  loadSessions();
+}
+
+DownloadSession::~DownloadSession()
+{
+  curl_easy_cleanup(m_curl);
+  curl_share_cleanup(m_share);
+  curl_global_cleanup();
+}
+
+DownloadResult DownloadSession::download(const std::string& url, const fs::path& path,
+                                         DownloadStats* stats)
+{
+  FileDownload download(url, path);
+
+  if (download.isFresh()) {
+    if (stats) {
+      *stats = {};
+    }
+
+    return DownloadResult::Fresh;
+  }
+
+  // a reset handle keeps its connections and caches
+  curl_easy_reset(m_curl);
+  setup(m_curl);
+  download.setup(m_curl);
+
+  const auto code   = curl_easy_perform(m_curl);
+  const auto result = download.finish(m_curl, code);
+
+  if (stats) {
+    *stats = download.stats();
+  }
+
+  saveSessions();
+
+  return result;
+}
+
+std::vector<DownloadOutcome>
+DownloadSession::downloadAll(const std::vector<DownloadRequest>& requests)
+{
+  std::vector<DownloadOutcome> outcomes(requests.size());
+  std::vector<std::unique_ptr<FileDownload>> downloads(requests.size());
+  std::vector<CURL*> handles(requests.size(), nullptr);
+
+  CURLM* multi = curl_multi_init();
+  if (!multi) {
+    throw std::runtime_error("Failed to initialize curl");
+  }
+
+  curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+
+  for (std::size_t i = 0; i < requests.size(); ++i) {
+    try {
+      downloads[i] = std::make_unique<FileDownload>(requests[i].url, requests[i].path);
+
+      if (downloads[i]->isFresh()) {
+        outcomes[i].result = DownloadResult::Fresh;
+        continue;
+      }
+
+      handles[i] = curl_easy_init();
+      if (!handles[i]) {
+        throw std::runtime_error("Failed to initialize curl");
+      }
+
+      setup(handles[i]);
+      downloads[i]->setup(handles[i]);
+
+      // transfers started together would each open a connection otherwise,
+      // this waits for the first one to find out whether it can multiplex
+      curl_easy_setopt(handles[i], CURLOPT_PIPEWAIT, 1L);
+
+      curl_multi_add_handle(multi, handles[i]);
+    } catch (const std::exception& e) {
+      outcomes[i].error = e.what();
+    }
+  }
+
+  for (;;) {
+    int running   = 0;
+    const auto mc = curl_multi_perform(multi, &running);
+
+    int left = 0;
+    while (CURLMsg* msg = curl_multi_info_read(multi, &left)) {
+      if (msg->msg != CURLMSG_DONE) {
+        continue;
+      }
+
+      const auto itor = std::find(handles.begin(), handles.end(), msg->easy_handle);
+      const auto i    = static_cast<std::size_t>(itor - handles.begin());
+
+      try {
+        outcomes[i].result = downloads[i]->finish(msg->easy_handle, msg->data.result);
+      } catch (const std::exception& e) {
+        outcomes[i].error = e.what();
+      }
+
+      outcomes[i].stats = downloads[i]->stats();
+    }
+
+    if (mc != CURLM_OK) {
+      for (auto& o : outcomes) {
+        if (!o.result && o.error.empty()) {
+          o.error = std::string("curl error: ") + curl_multi_strerror(mc);
+        }
+      }
+
+      break;
+    }
+
+    if (running == 0) {
+      break;
+    }
+
+    curl_multi_poll(multi, nullptr, 0, 1000, nullptr);
+  }
+
+  for (auto* h : handles) {
+    if (h) {
+      curl_multi_remove_handle(multi, h);
+      curl_easy_cleanup(h);
+    }
+  }
+
+  curl_multi_cleanup(multi);
+
+  saveSessions();
+
+  return outcomes;
+}
+
+void DownloadSession::setup(CURL* curl) const
+{
+  curl_easy_setopt(curl, CURLOPT_SHARE, m_share);
+
+  // an empty string enables every encoding curl was built with
+  curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+  curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+  curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+}
+
+#ifdef CURL_VERSION_SSLS_EXPORT
+
+// the session store is a sequence of records, each being the session key, the
+// hmac and the session data as length-prefixed blobs followed by the time
+// until which the session is valid
+
+void writeBlob(std::ostream& out, const void* data, std::uint32_t size)
+{
+  out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+  out.write(static_cast<const char*>(data), size);
+}
+
+bool readBlob(std::istream& in, std::string& blob)
+{
+  std::uint32_t size = 0;
+  if (!in.read(reinterpret_cast<char*>(&size), sizeof(size))) {
+    return false;
+  }
+
+  // a session is a few kilobytes at most, anything larger is a corrupt file
+  if (size > 1024 * 1024) {
+    return false;
+  }
+
+  blob.resize(size);
+  return static_cast<bool>(in.read(blob.data(), size));
+}
+
+bool sessionExportSupported()
+{
+  return (curl_version_info(CURLVERSION_NOW)->features & CURL_VERSION_SSLS_EXPORT) != 0;
+}
+
+void DownloadSession::loadSessions()
+{
+  if (m_sessionStore.empty() || !sessionExportSupported()) {
+    return;
+  }
+
+  std::ifstream in(m_sessionStore, std::ios::binary);
+  if (!in) {
+    return;
+  }
+
+  std::string key, hmac, data;
+  curl_off_t validUntil = 0;
+
+  while (readBlob(in, key) && readBlob(in, hmac) && readBlob(in, data) &&
+         in.read(reinterpret_cast<char*>(&validUntil), sizeof(validUntil))) {
+    if (validUntil != 0 && validUntil < secondsSinceEpoch()) {
+      continue;
+    }
+
+    curl_easy_ssls_import(m_curl, key.c_str(),
+                          reinterpret_cast<const unsigned char*>(hmac.data()),
+                          hmac.size(),
+                          reinterpret_cast<const unsigned char*>(data.data()),
+                          data.size());
+  }
+}
+
+void DownloadSession::saveSessions()
+{
+  if (m_sessionStore.empty() || !sessionExportSupported()) {
+    return;
+  }
+
+  const auto temp = fs::path(m_sessionStore).concat(".tmp");
+
+  {
+    std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+    if (!out) {
+      return;
+    }
+
+    // sessions are secrets, only the user should be able to read them
+    std::error_code ec;
+    fs::permissions(temp, fs::perms::owner_read | fs::perms::owner_write,
+                    fs::perm_options::replace, ec);
+
+    curl_easy_ssls_export(
+        m_curl,
+        [](CURL*, void* p, const char* key, const unsigned char* hmac,
+           size_t hmacSize, const unsigned char* data, size_t dataSize,
+           curl_off_t validUntil, int, const char*, size_t) {
+          auto& out = *static_cast<std::ofstream*>(p);
+
+          writeBlob(out, key, static_cast<std::uint32_t>(std::strlen(key)));
+          writeBlob(out, hmac, static_cast<std::uint32_t>(hmacSize));
+          writeBlob(out, data, static_cast<std::uint32_t>(dataSize));
+          out.write(reinterpret_cast<const char*>(&validUntil), sizeof(validUntil));
+
+          return CURLE_OK;
+        },
+        &out);
+  }
+
+  std::error_code ec;
+  fs::rename(temp, m_sessionStore, ec);
+}
+
+#else
+
+// this version of curl can't export tls sessions, they're only shared within
+// the process
+
+void DownloadSession::loadSessions() {}
+
+void DownloadSession::saveSessions() {}
+
+#endif
+
+}  // namespace lootcli
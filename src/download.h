@@ -0,0 +1,201 @@
+#ifndef LOOTCLI_DOWNLOAD_H
+#define LOOTCLI_DOWNLOAD_H
+
+#include <curl/curl.h>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace lootcli
+{
+
+enum class DownloadResult
+{
+  // the local file is still fresh according to the server's cache headers,
+  // no request was sent
+  Fresh,
+
+  // the server answered that the file was not modified
+  NotModified,
+
+  // the file was downloaded, but its content is the same as the local file
+  Unchanged,
+
+  // the file was downloaded and replaced the local file
+  Updated
+};
+
+std::string toString(DownloadResult r);
+
+// what a transfer cost on the network
+//
+struct DownloadStats
+{
+  // headers and body as received, before decompression
+  std::int64_t bytesOnWire = 0;
+
+  // body after decompression
+  std::int64_t bytesDecoded = 0;
+
+  // time spent on the tls handshake, 0 if an existing connection was reused
+  std::int64_t handshakeMicroseconds = 0;
+
+  // "1.1", "2" or "3", empty if no request was sent
+  std::string httpVersion;
+
+  bool connectionReused = false;
+
+  // why the validators of the file couldn't be saved, empty if they were;
+  // the download still succeeded
+  std::string validatorsError;
+};
+
+std::string toString(const DownloadStats& s);
+
+// http cache validators of a downloaded file, stored in a sidecar file next to
+// it so they survive between runs
+//
+struct CacheValidators
+{
+  std::string url;
+  std::string etag;
+  std::string lastModified;
+
+  // seconds since the epoch until which the file is fresh, 0 if it must be
+  // revalidated
+  std::int64_t expires = 0;
+
+  static std::filesystem::path sidecarPath(const std::filesystem::path& file);
+
+  // returns empty validators if the sidecar doesn't exist or is invalid
+  static CacheValidators load(const std::filesystem::path& file);
+
+  // replaces the sidecar atomically, throws on failure
+  void save(const std::filesystem::path& file) const;
+};
+
+// a single download of a url into a file
+//
+// the local file is never truncated: the content is written to a temporary
+// file that only replaces the local file once the transfer succeeded and the
+// content has actually changed; if the server supports it, the transfer is
+// conditional on the validators from the previous download
+//
+class FileDownload
+{
+public:
+  FileDownload(std::string url, std::filesystem::path path);
+  ~FileDownload();
+
+  FileDownload(const FileDownload&)            = delete;
+  FileDownload& operator=(const FileDownload&) = delete;
+
+  const std::string& url() const;
+  const std::filesystem::path& path() const;
+
+  // whether the local file can be used as is without sending a request
+  //
+  bool isFresh() const;
+
+  // opens the temporary file and sets the options for this transfer on the
+  // given handle, which must stay alive until finish() is called
+  //
+  void setup(CURL* curl);
+
+  // checks the result of the transfer, replaces the local file if needed and
+  // saves the new validators; throws on failure
+  //
+  DownloadResult finish(CURL* curl, CURLcode code);
+
+  // network statistics of the transfer, filled by finish()
+  //
+  const DownloadStats& stats() const;
+
+private:
+  std::string m_url;
+  std::filesystem::path m_path;
+  std::filesystem::path m_tempPath;
+  CacheValidators m_old;
+  CacheValidators m_new;
+  std::int64_t m_maxAge;
+  std::int64_t m_age;
+  bool m_noCache;
+  FILE* m_file;
+  curl_slist* m_headers;
+  DownloadStats m_stats;
+
+  static size_t onHeader(char* buffer, size_t size, size_t count, void* self);
+  static size_t onWrite(char* buffer, size_t size, size_t count, void* self);
+  void parseHeader(std::string_view line);
+  void closeFile();
+};
+
+// one file of DownloadSession::downloadAll()
+//
+struct DownloadRequest
+{
+  std::string url;
+  std::filesystem::path path;
+};
+
+struct DownloadOutcome
+{
+  // empty if the download failed
+  std::optional<DownloadResult> result;
+
+  // why the download failed
+  std::string error;
+
+  DownloadStats stats;
+};
+
+// state shared by all downloads of a process: one reused easy handle and a
+// share handle for tls sessions, dns lookups and open connections, so later
+// downloads from the same host skip the lookup and the full handshake
+//
+// if curl supports exporting tls sessions, they are also saved to the given
+// store and loaded by the next process
+//
+class DownloadSession
+{
+public:
+  explicit DownloadSession(std::filesystem::path sessionStore = {});
+  ~DownloadSession();
+
+  DownloadSession(const DownloadSession&)            = delete;
+  DownloadSession& operator=(const DownloadSession&) = delete;
+
+  // downloads the given url into the file, see FileDownload; if given, stats
+  // receives the network statistics of the transfer
+  //
+  DownloadResult download(const std::string& url, const std::filesystem::path& path,
+                          DownloadStats* stats = nullptr);
+
+  // downloads all the files concurrently on a multi handle, transfers to the
+  // same host are multiplexed on one http/2 connection when the server
+  // supports it; a failed download doesn't stop the others, the outcomes are
+  // in the same order as the requests
+  //
+  std::vector<DownloadOutcome>
+  downloadAll(const std::vector<DownloadRequest>& requests);
+
+  // sets the options common to all transfers on the given handle, such as
+  // compression and http/2, and attaches it to the share handle
+  //
+  void setup(CURL* curl) const;
+
+private:
+  std::filesystem::path m_sessionStore;
+  CURLSH* m_share;
+  CURL* m_curl;
+
+  void loadSessions();
+  void saveSessions();
+};
+
+}  // namespace lootcli
+
+#endif  // LOOTCLI_DOWNLOAD_H
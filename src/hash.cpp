@@ -0,0 +1,46 @@
+#include "hash.h"
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace lootcli
+{
+
+std::string toHex(std::uint64_t value)
+{
+  std::ostringstream ss;
+  ss << std::hex << std::setw(16) << std::setfill('0') << value;
+  return ss.str();
+}
+
+std::uint64_t hashBytes(std::string_view bytes, std::uint64_t hash)
+{
+  // FNV-1a, good enough to tell whether a file's content has changed
+  for (const unsigned char c : bytes) {
+    hash ^= c;
+    hash *= 0x100000001b3ull;
+  }
+
+  return hash;
+}
+
+std::uint64_t hashFile(const fs::path& path, std::uint64_t hash)
+{
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    return hash;
+  }
+
+  std::vector<char> buffer(64 * 1024);
+  while (in) {
+    in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    hash = hashBytes({buffer.data(), static_cast<std::size_t>(in.gcount())}, hash);
+  }
+
+  return hash;
+}
+
+}  // namespace lootcli
@@ -0,0 +1,25 @@
+#ifndef LOOTCLI_HASH_H
+#define LOOTCLI_HASH_H
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+namespace lootcli
+{
+
+constexpr std::uint64_t EMPTY_HASH = 0xcbf29ce484222325ull;
+
+// FNV-1a hashes, continuing from the given hash; a file that can't be read
+// leaves the hash unchanged
+std::uint64_t hashBytes(std::string_view bytes, std::uint64_t hash = EMPTY_HASH);
+std::uint64_t hashFile(const std::filesystem::path& path,
+                       std::uint64_t hash = EMPTY_HASH);
+
+// 16 lowercase hex digits
+std::string toHex(std::uint64_t value);
+
+}  // namespace lootcli
+
+#endif  // LOOTCLI_HASH_H
@@ -0,0 +1,228 @@
+#include "json_writer.h"
+
+namespace lootcli
+{
+
+// length of the utf-8 sequence starting at s[i], 0 if it's invalid
+//
+std::size_t utf8SequenceLength(std::string_view s, std::size_t i)
+{
+  const auto c = static_cast<unsigned char>(s[i]);
+
+  std::size_t length = 0;
+  char32_t cp        = 0;
+
+  if (c < 0x80) {
+    return 1;
+  } else if ((c & 0xe0) == 0xc0) {
+    length = 2;
+    cp     = c & 0x1f;
+  } else if ((c & 0xf0) == 0xe0) {
+    length = 3;
+    cp     = c & 0x0f;
+  } else if ((c & 0xf8) == 0xf0) {
+    length = 4;
+    cp     = c & 0x07;
+  } else {
+    return 0;
+  }
+
+  if (i + length > s.size()) {
+    return 0;
+  }
+
+  for (std::size_t j = 1; j < length; ++j) {
+    const auto cc = static_cast<unsigned char>(s[i + j]);
+    if ((cc & 0xc0) != 0x80) {
+      return 0;
+    }
+
+    cp = (cp << 6) | (cc & 0x3f);
+  }
+
+  // overlong encodings, surrogates and values past the last code point
+  static constexpr char32_t smallest[] = {0, 0, 0x80, 0x800, 0x10000};
+  if (cp < smallest[length] || (cp >= 0xd800 && cp <= 0xdfff) || cp > 0x10ffff) {
+    return 0;
+  }
+
+  return length;
+}
+
+JsonWriter::JsonWriter(std::string& out, int depth, bool compact,
+                       std::pmr::memory_resource* scratch)
+    : m_out(out), m_depth(depth), m_compact(compact), m_empty(scratch),
+      m_afterKey(false)
+{}
+
+void JsonWriter::endDocument()
+{
+  if (!m_compact) {
+    m_out += '\n';
+  }
+}
+
+void JsonWriter::beginObject()
+{
+  beginValue();
+  m_out += (m_compact ? "{" : "{\n");
+  m_empty.push_back(true);
+}
+
+void JsonWriter::endObject()
+{
+  end('}');
+}
+
+void JsonWriter::beginArray()
+{
+  beginValue();
+  m_out += (m_compact ? "[" : "[\n");
+  m_empty.push_back(true);
+}
+
+void JsonWriter::endArray()
+{
+  end(']');
+}
+
+void JsonWriter::key(std::string_view name)
+{
+  beginValue();
+  string(name);
+  m_out += (m_compact ? ":" : ": ");
+  m_afterKey = true;
+}
+
+void JsonWriter::value(std::string_view s)
+{
+  beginValue();
+  string(s);
+}
+
+void JsonWriter::value(std::int64_t i)
+{
+  beginValue();
+  m_out += std::to_string(i);
+}
+
+void JsonWriter::value(bool b)
+{
+  beginValue();
+  m_out += (b ? "true" : "false");
+}
+
+void JsonWriter::raw(std::string_view json)
+{
+  beginValue();
+  m_out += json;
+}
+
+void JsonWriter::beginValue()
+{
+  if (m_afterKey) {
+    m_afterKey = false;
+    return;
+  }
+
+  if (m_empty.empty()) {
+    return;
+  }
+
+  if (!m_empty.back()) {
+    m_out += (m_compact ? "," : ",\n");
+  }
+
+  m_empty.back() = false;
+  indent(m_depth + static_cast<int>(m_empty.size()));
+}
+
+void JsonWriter::end(char c)
+{
+  const bool empty = m_empty.back();
+  m_empty.pop_back();
+
+  if (!empty && !m_compact) {
+    m_out += '\n';
+  }
+
+  indent(m_depth + static_cast<int>(m_empty.size()));
+  m_out += c;
+}
+
+void JsonWriter::indent(int depth)
+{
+  if (m_compact) {
+    return;
+  }
+
+  m_out.append(static_cast<std::size_t>(depth) * 4, ' ');
+}
+
+void JsonWriter::string(std::string_view s)
+{
+  static constexpr char hex[] = "0123456789abcdef";
+
+  m_out += '"';
+
+  for (std::size_t i = 0; i < s.size();) {
+    const char c = s[i];
+
+    switch (c) {
+    case '"':
+      m_out += "\\\"";
+      break;
+
+    case '\\':
+      m_out += "\\\\";
+      break;
+
+    case '\b':
+      m_out += "\\b";
+      break;
+
+    case '\f':
+      m_out += "\\f";
+      break;
+
+    case '\n':
+      m_out += "\\n";
+      break;
+
+    case '\r':
+      m_out += "\\r";
+      break;
+
+    case '\t':
+      m_out += "\\t";
+      break;
+
+    default: {
+      const auto u = static_cast<unsigned char>(c);
+
+      if (u < 0x20) {
+        m_out += "\\u00";
+        m_out += hex[u >> 4];
+        m_out += hex[u & 0xf];
+      } else if (u < 0x80) {
+        m_out += c;
+      } else if (const auto length = utf8SequenceLength(s, i)) {
+        m_out.append(s.substr(i, length));
+        i += length;
+        continue;
+      } else {
+        // invalid utf-8 is replaced by U+FFFD, like QString does
+        m_out += "\xef\xbf\xbd";
+      }
+
+      break;
+    }
+    }
+
+    ++i;
+  }
+
+  m_out += '"';
+}
+
+}  // namespace lootcli
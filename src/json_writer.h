@@ -0,0 +1,68 @@
+#ifndef LOOTCLI_JSON_WRITER_H
+#define LOOTCLI_JSON_WRITER_H
+
+#include "report_writer.h"
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+namespace lootcli
+{
+
+// writes utf-8 json
+//
+// the indented layout is the same as QJsonDocument::Indented: four spaces per
+// level and one member or element per line; the compact layout has no
+// whitespace at all, like QJsonDocument::Compact
+//
+class JsonWriter : public ReportWriter
+{
+public:
+  // depth is the indentation level of the value that's about to be written,
+  // so a value can be written separately and pasted into another document
+  // with raw(); the writer's own bookkeeping is allocated from scratch
+  //
+  explicit JsonWriter(std::string& out, int depth = 0, bool compact = false,
+                      std::pmr::memory_resource* scratch =
+                          std::pmr::get_default_resource());
+
+  void endDocument() override;
+
+  void beginObject() override;
+  void endObject() override;
+
+  void beginArray() override;
+  void endArray() override;
+
+  void key(std::string_view name) override;
+
+  using ReportWriter::value;
+  void value(std::string_view s) override;
+  void value(std::int64_t i) override;
+  void value(bool b) override;
+
+  // the value must have been written by a writer created with the depth of
+  // this one
+  //
+  void raw(std::string_view json) override;
+
+private:
+  std::string& m_out;
+  int m_depth;
+  bool m_compact;
+
+  // one entry per open object or array, whether nothing was written in it yet
+  std::pmr::vector<bool> m_empty;
+
+  // a key was just written, the next value goes on the same line
+  bool m_afterKey;
+
+  void beginValue();
+  void end(char c);
+  void indent(int depth);
+  void string(std::string_view s);
+};
+
+}  // namespace lootcli
+
+#endif  // LOOTCLI_JSON_WRITER_H
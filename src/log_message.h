@@ -0,0 +1,59 @@
+#ifndef LOOTCLI_LOG_MESSAGE_H
+#define LOOTCLI_LOG_MESSAGE_H
+
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// log statements below this level are compiled out, the value is a
+// loot::LogLevel; release builds can set it to 2 to drop trace and debug
+// logging entirely
+#ifndef LOOTCLI_MIN_LOG_LEVEL
+#define LOOTCLI_MIN_LOG_LEVEL 0
+#endif
+
+// logs the concatenation of the arguments at the given level, which must be
+// a constant; the arguments are only evaluated when the level is logged, so a
+// disabled statement doesn't build any strings
+//
+// used in members of a class with logEnabled(level) and log(level, message)
+//
+#define LOOTCLI_LOG(level, ...)                                                        \
+  do {                                                                                 \
+    if constexpr (static_cast<int>(level) >= LOOTCLI_MIN_LOG_LEVEL) {                  \
+      if (logEnabled(level)) {                                                         \
+        log(level, ::lootcli::logMessage(__VA_ARGS__));                                \
+      }                                                                                \
+    }                                                                                  \
+  } while (false)
+
+namespace lootcli
+{
+
+inline void appendLogPart(std::string& s, std::string_view part)
+{
+  s += part;
+}
+
+template <class T>
+  requires std::is_arithmetic_v<T>
+void appendLogPart(std::string& s, T n)
+{
+  s += std::to_string(n);
+}
+
+// strings as they are and numbers in decimal, one allocation for the whole
+// message
+//
+template <class... Parts>
+std::string logMessage(const Parts&... parts)
+{
+  std::string s;
+  s.reserve(128);
+  (appendLogPart(s, parts), ...);
+  return s;
+}
+
+}  // namespace lootcli
+
+#endif  // LOOTCLI_LOG_MESSAGE_H
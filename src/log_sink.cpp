@@ -0,0 +1,243 @@
+#include "log_sink.h"
+#include <iostream>
+
+namespace lootcli
+{
+
+// lines the queue holds, a power of two
+constexpr std::uint64_t QUEUE_SIZE = 4096;
+
+// a batch is written once it gets this big
+constexpr std::size_t MAX_BATCH = 64 * 1024;
+
+// longest a line waits for a batch to be written
+constexpr auto FLUSH_DELAY = std::chrono::milliseconds(50);
+
+// how often the queue is emptied while a batch is waiting
+constexpr auto POLL_INTERVAL = std::chrono::milliseconds(1);
+
+std::optional<LogOverflow> logOverflowFromString(std::string_view s)
+{
+  if (s == "block") {
+    return LogOverflow::Block;
+  } else if (s == "drop") {
+    return LogOverflow::Drop;
+  } else {
+    return {};
+  }
+}
+
+LogSink::LogSink()
+    : m_slots(std::make_unique<Slot[]>(QUEUE_SIZE)), m_overflow(LogOverflow::Block),
+      m_tail(0), m_head(0), m_dropped(0), m_droppedReported(0), m_sleeping(false),
+      m_flushTarget(0), m_written(0), m_stopping(false)
+{
+  for (std::uint64_t i = 0; i < QUEUE_SIZE; ++i) {
+    m_slots[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  m_writer = std::thread([this] {
+    run();
+  });
+}
+
+LogSink::~LogSink()
+{
+  {
+    std::lock_guard lock(m_mutex);
+    m_stopping    = true;
+    m_flushTarget = m_tail.load();
+  }
+
+  m_wake.notify_one();
+  m_writer.join();
+}
+
+void LogSink::setOverflow(LogOverflow overflow)
+{
+  m_overflow = overflow;
+}
+
+void LogSink::push(std::string line)
+{
+  if (m_overflow.load(std::memory_order_relaxed) == LogOverflow::Drop) {
+    if (!tryPush(line)) {
+      m_dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+  } else {
+    blockingPush(line);
+  }
+
+  wake();
+}
+
+void LogSink::pushAndFlush(std::string line)
+{
+  blockingPush(line);
+  flush();
+}
+
+std::uint64_t LogSink::queued() const
+{
+  return m_tail.load(std::memory_order_relaxed);
+}
+
+std::uint64_t LogSink::dropped() const
+{
+  return m_dropped.load(std::memory_order_relaxed);
+}
+
+void LogSink::flush()
+{
+  std::unique_lock lock(m_mutex);
+
+  // lines at positions before the tail may still be being filled, the
+  // writer waits for them
+  const auto target = m_tail.load();
+  m_flushTarget     = std::max(m_flushTarget, target);
+
+  m_wake.notify_one();
+  m_flushed.wait(lock, [&] {
+    return m_written >= target;
+  });
+}
+
+bool LogSink::tryPush(std::string& line)
+{
+  auto pos = m_tail.load(std::memory_order_relaxed);
+
+  for (;;) {
+    auto& slot     = m_slots[pos & (QUEUE_SIZE - 1)];
+    const auto seq = slot.sequence.load(std::memory_order_acquire);
+
+    if (seq == pos) {
+      if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        slot.line = std::move(line);
+
+        // sequentially consistent, along with m_sleeping, so either the
+        // writer sees the line or this thread sees that it must wake it
+        slot.sequence.store(pos + 1);
+        return true;
+      }
+    } else if (seq < pos) {
+      // the slot still has the line from a lap ago, the queue is full
+      return false;
+    } else {
+      // another producer took this position
+      pos = m_tail.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+bool LogSink::tryPop(std::string& line)
+{
+  auto& slot = m_slots[m_head & (QUEUE_SIZE - 1)];
+
+  if (slot.sequence.load(std::memory_order_acquire) != m_head + 1) {
+    return false;
+  }
+
+  line = std::move(slot.line);
+  slot.sequence.store(m_head + QUEUE_SIZE, std::memory_order_release);
+  ++m_head;
+
+  return true;
+}
+
+bool LogSink::ready() const
+{
+  return m_slots[m_head & (QUEUE_SIZE - 1)].sequence.load() == m_head + 1;
+}
+
+void LogSink::wake()
+{
+  if (m_sleeping.load()) {
+    std::lock_guard lock(m_mutex);
+    m_wake.notify_one();
+  }
+}
+
+void LogSink::blockingPush(std::string& line)
+{
+  while (!tryPush(line)) {
+    std::this_thread::yield();
+  }
+
+  wake();
+}
+
+void LogSink::run()
+{
+  std::string batch;
+  std::string line;
+  Clock::time_point oldest;
+
+  for (;;) {
+    while (batch.size() < MAX_BATCH && tryPop(line)) {
+      if (batch.empty()) {
+        oldest = Clock::now();
+      }
+
+      batch += line;
+    }
+
+    std::unique_lock lock(m_mutex);
+
+    if (m_head < m_flushTarget && batch.size() < MAX_BATCH) {
+      // a line that must be flushed is still being pushed
+      lock.unlock();
+      std::this_thread::yield();
+      continue;
+    }
+
+    if (!batch.empty() && (m_flushTarget > m_written || m_stopping ||
+                           batch.size() >= MAX_BATCH ||
+                           Clock::now() - oldest >= FLUSH_DELAY)) {
+      lock.unlock();
+      write(batch);
+      lock.lock();
+    }
+
+    if (batch.empty()) {
+      m_written = m_head;
+      m_flushed.notify_all();
+
+      if (m_stopping && m_head >= m_flushTarget) {
+        return;
+      }
+
+      m_sleeping = true;
+      m_wake.wait(lock, [&] {
+        return ready() || m_flushTarget > m_written || m_stopping;
+      });
+      m_sleeping = false;
+    } else {
+      // producers don't wake the writer while a batch waits, the queue is
+      // emptied regularly instead so it doesn't fill up
+      const auto until = std::min(oldest + FLUSH_DELAY, Clock::now() + POLL_INTERVAL);
+
+      m_wake.wait_until(lock, until, [&] {
+        return m_flushTarget > m_written || m_stopping;
+      });
+    }
+  }
+}
+
+void LogSink::write(std::string& batch)
+{
+  const auto dropped = m_dropped.load(std::memory_order_relaxed);
+
+  if (dropped != m_droppedReported) {
+    batch += "[warning] " + std::to_string(dropped - m_droppedReported) +
+             " log lines were dropped, the output couldn't keep up\n";
+    m_droppedReported = dropped;
+  }
+
+  std::cout.write(batch.data(), static_cast<std::streamsize>(batch.size()));
+  std::cout.flush();
+
+  batch.clear();
+}
+
+}  // namespace lootcli
@@ -0,0 +1,121 @@
+#ifndef LOOTCLI_LOG_SINK_H
+#define LOOTCLI_LOG_SINK_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace lootcli
+{
+
+// what happens to a log line when the queue of the sink is full
+//
+enum class LogOverflow
+{
+  // the thread logging waits until there's room
+  Block = 0,
+
+  // the line is dropped and counted, a warning with the count is written
+  // with the next batch
+  Drop
+};
+
+std::optional<LogOverflow> logOverflowFromString(std::string_view s);
+
+// writes lines to stdout from its own thread
+//
+// lines are put in a bounded lock-free queue that any thread can push to and
+// the writer thread takes them out in batches, so logging never waits for
+// stdout and lines from different threads never interleave; the writer
+// flushes stdout when asked to, when a batch gets big or when a line has
+// been waiting for a short while
+//
+class LogSink
+{
+public:
+  LogSink();
+
+  // writes everything that's left and stops the writer
+  ~LogSink();
+
+  LogSink(const LogSink&)            = delete;
+  LogSink& operator=(const LogSink&) = delete;
+
+  void setOverflow(LogOverflow overflow);
+
+  // queues a line, which must end with a newline; may drop it when the queue
+  // is full, depending on the overflow policy
+  //
+  void push(std::string line);
+
+  // queues a line that's never dropped, such as progress, and flushes
+  //
+  void pushAndFlush(std::string line);
+
+  // returns once everything queued before the call is on stdout
+  //
+  void flush();
+
+  // lines queued and lines dropped since the sink was created
+  //
+  std::uint64_t queued() const;
+  std::uint64_t dropped() const;
+
+private:
+  struct Slot
+  {
+    // position the slot is ready for: a producer can fill it when this is
+    // the position, the writer can take it when it's one past
+    std::atomic<std::uint64_t> sequence;
+    std::string line;
+  };
+
+  using Clock = std::chrono::steady_clock;
+
+  std::unique_ptr<Slot[]> m_slots;
+  std::atomic<LogOverflow> m_overflow;
+
+  // next position to fill, shared by producers
+  alignas(64) std::atomic<std::uint64_t> m_tail;
+
+  // next position to take, only used by the writer
+  alignas(64) std::uint64_t m_head;
+
+  std::atomic<std::uint64_t> m_dropped;
+  std::uint64_t m_droppedReported;
+
+  // the writer is waiting for lines, producers must wake it up
+  std::atomic<bool> m_sleeping;
+
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::condition_variable m_flushed;
+
+  // everything before this position must be written, set by flush()
+  std::uint64_t m_flushTarget;
+
+  // everything before this position is on stdout
+  std::uint64_t m_written;
+
+  bool m_stopping;
+  std::thread m_writer;
+
+  bool tryPush(std::string& line);
+  bool tryPop(std::string& line);
+  bool ready() const;
+  void wake();
+  void blockingPush(std::string& line);
+  void run();
+  void write(std::string& batch);
+};
+
+}  // namespace lootcli
+
+#endif  // LOOTCLI_LOG_SINK_H
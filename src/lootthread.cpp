@@ -1,18 +1,38 @@
 #pragma comment(lib, "winhttp.lib")
 
 #include "lootthread.h"
+#include "cbor_writer.h"
+#include "delta.h"
+#include "download.h"
 #include "game_settings.h"
+#include "json_writer.h"
+#include "message_cache.h"
+#include "plugin_index.h"
 #include "version.h"
 #include <QDir>
-#include <QJsonObject>
 #include <QStandardPaths>
 #include <boost/algorithm/string.hpp>
 #include <boost/locale.hpp>
 #include <curl/curl.h>
 #include <curl/easy.h>
+#include <array>
+#include <atomic>
 #include <fstream>
+#include <future>
+#include <iomanip>
 #include <iostream>
+#include <memory_resource>
 #include <mutex>
+#include <numeric>
+#include <regex>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
 
 // using namespace loot;
 namespace fs = std::filesystem;
@@ -29,23 +49,11 @@ static const std::regex GITHUB_REPO_URL_REGEX =
     std::regex(R"(^https://github\.com/([^/]+)/([^/]+?)(?:\.git)?/?$)",
                std::regex::ECMAScript | std::regex::icase);
 
-std::string toString(loot::MessageType type)
-{
-  switch (type) {
-  case loot::MessageType::say:
-    return "info";
-  case loot::MessageType::warn:
-    return "warn";
-  case loot::MessageType::error:
-    return "error";
-  default:
-    return "unknown";
-  }
-}
-
 LOOTWorker::LOOTWorker()
     : m_GameId(loot::GameId::tes5), m_GameName("Skyrim"),
-      m_LogLevel(loot::LogLevel::info)
+      m_LogLevel(loot::LogLevel::info), m_VerifyIncremental(false), m_Threads(1),
+      m_ReportFormat(ReportFormat::Json), m_MessageTable(false),
+      m_LocaleInitialised(false), m_Delta(false)
 {}
 
 std::string ToLower(std::string text)
@@ -100,6 +108,46 @@ void LOOTWorker::setUpdateMasterlist(bool update)
   m_UpdateMasterlist = update;
 }
 
+void LOOTWorker::setThreads(unsigned int threads)
+{
+  m_Threads = threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+}
+
+void LOOTWorker::setReportFormat(ReportFormat format)
+{
+  m_ReportFormat = format;
+}
+
+void LOOTWorker::setTraceFile(const std::string& path)
+{
+  m_TracePath = path;
+}
+
+void LOOTWorker::setLogOverflow(LogOverflow overflow)
+{
+  m_Output.setOverflow(overflow);
+}
+
+void LOOTWorker::setLootDataPath(const std::string& path)
+{
+  m_LootDataPath = path;
+}
+
+void LOOTWorker::setDelta(bool delta)
+{
+  m_Delta = delta;
+}
+
+void LOOTWorker::setMessageTable(bool table)
+{
+  m_MessageTable = table;
+}
+
+void LOOTWorker::setVerifyIncremental(bool verify)
+{
+  m_VerifyIncremental = verify;
+}
+
 void LOOTWorker::setPluginListPath(const std::string& pluginListPath)
 {
   m_PluginListPath = pluginListPath;
@@ -125,9 +173,18 @@ fs::path GetLOOTAppData()
   return QDir(paths.first()).filesystemAbsolutePath() / "LOOT";
 }
 
+fs::path LOOTWorker::lootDataPath() const
+{
+  if (!m_LootDataPath.empty()) {
+    return m_LootDataPath;
+  }
+
+  return GetLOOTAppData();
+}
+
 fs::path LOOTWorker::gamePath() const
 {
-  return GetLOOTAppData() / "games" / m_GameSettings.FolderName();
+  return lootDataPath() / "games" / m_GameSettings.FolderName();
 }
 
 fs::path LOOTWorker::masterlistPath() const
@@ -141,12 +198,12 @@ fs::path LOOTWorker::userlistPath() const
 }
 fs::path LOOTWorker::settingsPath() const
 {
-  return GetLOOTAppData() / "settings.toml";
+  return lootDataPath() / "settings.toml";
 }
 
 fs::path LOOTWorker::l10nPath() const
 {
-  return GetLOOTAppData() / "resources" / "l10n";
+  return lootDataPath() / "resources" / "l10n";
 }
 
 fs::path LOOTWorker::dataPath() const
@@ -154,16 +211,22 @@ fs::path LOOTWorker::dataPath() const
   return m_GameSettings.DataPath();
 }
 
-void LOOTWorker::getSettings(const fs::path& file)
+// Don't use cpptoml::parse_file() as it just uses a std stream,
+// which don't support UTF-8 paths on Windows.
+toml::table readSettingsFile(const fs::path& file)
 {
-  lock_guard<recursive_mutex> guard(mutex_);
-  // Don't use cpptoml::parse_file() as it just uses a std stream,
-  // which don't support UTF-8 paths on Windows.
   std::ifstream in(file);
   if (!in.is_open())
     throw std::runtime_error(file.string() + " could not be opened for parsing");
 
-  const auto settings = toml::parse(in, file.string());
+  return toml::parse(in, file.string());
+}
+
+void LOOTWorker::getSettings(const fs::path& file)
+{
+  lock_guard<recursive_mutex> guard(mutex_);
+
+  const auto settings = readSettingsFile(file);
   const auto games    = settings["games"];
   if (games.is_array_of_tables()) {
     for (const auto& game : *games.as_array()) {
@@ -173,122 +236,162 @@ void LOOTWorker::getSettings(const fs::path& file)
         }
         auto gameTable = *game.as_table();
 
-        using loot::GameId;
-        using loot::GameSettings;
+        auto newSettings = newGameSettings(gameTable);
 
-        auto id = gameTable["gameId"].value<std::string>();
-        if (!id) {
-          throw std::runtime_error(
-              "'gameId' and 'type' keys both missing from game settings table");
-        }
-        const auto gameType = *id;
-        GameId gameId;
-
-        if (gameType == "Morrowind") {
-          gameId = GameId::tes3;
-        } else if (gameType == "Oblivion") {
-          // The Oblivion game type is shared between Oblivon and Nehrim.
-          gameId = IsNehrim(gameTable) ? GameId::nehrim : GameId::tes4;
-        } else if (gameType == "Skyrim") {
-          // The Skyrim game type is shared between Skyrim and Enderal.
-          gameId = IsEnderal(gameTable) ? GameId::enderal : GameId::tes5;
-        } else if (gameType == "SkyrimSE" || gameType == "Skyrim Special Edition") {
-          // The Skyrim SE game type is shared between Skyrim SE and Enderal SE.
-          gameId = IsEnderalSE(gameTable) ? GameId::enderalse : GameId::tes5se;
-        } else if (gameType == "Skyrim VR") {
-          gameId = GameId::tes5vr;
-        } else if (gameType == "Fallout3") {
-          gameId = GameId::fo3;
-        } else if (gameType == "FalloutNV") {
-          gameId = GameId::fonv;
-        } else if (gameType == "Fallout4") {
-          gameId = GameId::fo4;
-        } else if (gameType == "Fallout4VR") {
-          gameId = GameId::fo4vr;
-        } else if (gameType == "Starfield") {
-          gameId = GameId::starfield;
-        } else if (gameType == "OpenMW") {
-          gameId = GameId::openmw;
-        } else if (gameType == "Oblivion Remastered") {
-          gameId = GameId::oblivionRemastered;
-        } else {
-          throw std::runtime_error(
-              "invalid value for 'type' key in game settings table");
+        if (newSettings.Type() == m_GameSettings.Type()) {
+          readGameSettings(gameTable, newSettings);
+          m_GameSettings = newSettings;
+          break;
         }
+      } catch (...) {
+        // Skip invalid games.
+      }
+    }
+  }
 
-        auto folder = gameTable["folder"].value<std::string>();
-        if (!folder) {
-          throw std::runtime_error("'folder' key missing from game settings table");
-        }
+  if (m_Language.empty()) {
+    m_Language = settings["language"].value_or(loot::MessageContent::DEFAULT_LANGUAGE);
+  }
+}
+
+std::vector<loot::GameSettings> LOOTWorker::getAllGameSettings(const fs::path& file)
+{
+  lock_guard<recursive_mutex> guard(mutex_);
 
-        const auto type = gameTable["type"].value<std::string>();
+  std::vector<loot::GameSettings> list;
 
-        // SkyrimSE was a previous serialised value for GameType::tes5se,
-        // and the game folder name LOOT created for that game type.
-        if (type && *type == "SkyrimSE" && *folder == *type) {
-          folder = "Skyrim Special Edition";
+  const auto settings = readSettingsFile(file);
+  const auto games    = settings["games"];
+  if (games.is_array_of_tables()) {
+    for (const auto& game : *games.as_array()) {
+      try {
+        if (!game.is_table()) {
+          throw std::runtime_error("games array element is not a table");
         }
+        auto gameTable = *game.as_table();
 
-        GameSettings newSettings(gameId, folder.value());
+        auto newSettings = newGameSettings(gameTable);
+        readGameSettings(gameTable, newSettings);
+        list.push_back(newSettings);
+      } catch (const std::exception& e) {
+        LOOTCLI_LOG(loot::LogLevel::warning, "skipping invalid game settings: ",
+                    e.what());
+      }
+    }
+  }
 
-        if (newSettings.Type() == m_GameSettings.Type()) {
+  return list;
+}
 
-          auto name = gameTable["name"].value<std::string>();
-          if (name) {
-            newSettings.SetName(*name);
-          }
+loot::GameSettings LOOTWorker::newGameSettings(const toml::table& gameTable)
+{
+  using loot::GameId;
+  using loot::GameSettings;
 
-          auto master = gameTable["master"].value<std::string>();
-          if (master) {
-            newSettings.SetMaster(*master);
-          }
+  auto id = gameTable["gameId"].value<std::string>();
+  if (!id) {
+    throw std::runtime_error(
+        "'gameId' and 'type' keys both missing from game settings table");
+  }
+  const auto gameType = *id;
+  GameId gameId;
+
+  if (gameType == "Morrowind") {
+    gameId = GameId::tes3;
+  } else if (gameType == "Oblivion") {
+    // The Oblivion game type is shared between Oblivon and Nehrim.
+    gameId = IsNehrim(gameTable) ? GameId::nehrim : GameId::tes4;
+  } else if (gameType == "Skyrim") {
+    // The Skyrim game type is shared between Skyrim and Enderal.
+    gameId = IsEnderal(gameTable) ? GameId::enderal : GameId::tes5;
+  } else if (gameType == "SkyrimSE" || gameType == "Skyrim Special Edition") {
+    // The Skyrim SE game type is shared between Skyrim SE and Enderal SE.
+    gameId = IsEnderalSE(gameTable) ? GameId::enderalse : GameId::tes5se;
+  } else if (gameType == "Skyrim VR") {
+    gameId = GameId::tes5vr;
+  } else if (gameType == "Fallout3") {
+    gameId = GameId::fo3;
+  } else if (gameType == "FalloutNV") {
+    gameId = GameId::fonv;
+  } else if (gameType == "Fallout4") {
+    gameId = GameId::fo4;
+  } else if (gameType == "Fallout4VR") {
+    gameId = GameId::fo4vr;
+  } else if (gameType == "Starfield") {
+    gameId = GameId::starfield;
+  } else if (gameType == "OpenMW") {
+    gameId = GameId::openmw;
+  } else if (gameType == "Oblivion Remastered") {
+    gameId = GameId::oblivionRemastered;
+  } else {
+    throw std::runtime_error("invalid value for 'type' key in game settings table");
+  }
 
-          const auto minimumHeaderVersion =
-              gameTable["minimumHeaderVersion"].value<double>();
-          if (minimumHeaderVersion) {
-            newSettings.SetMinimumHeaderVersion((float)*minimumHeaderVersion);
-          }
+  auto folder = gameTable["folder"].value<std::string>();
+  if (!folder) {
+    throw std::runtime_error("'folder' key missing from game settings table");
+  }
 
-          auto source = gameTable["masterlistSource"].value<std::string>();
-          if (source) {
-            newSettings.SetMasterlistSource(migrateMasterlistSource(*source));
-          } else {
-            auto url    = gameTable["repo"].value<std::string>();
-            auto branch = gameTable["branch"].value<std::string>();
-            auto migratedSource =
-                migrateMasterlistRepoSettings(newSettings.Id(), *url, *branch);
-            if (migratedSource.has_value()) {
-              newSettings.SetMasterlistSource(migratedSource.value());
-            }
-          }
+  const auto type = gameTable["type"].value<std::string>();
 
-          auto path = gameTable["path"].value<std::string>();
-          if (path) {
-            newSettings.SetGamePath(std::filesystem::path(*path));
-          }
+  // SkyrimSE was a previous serialised value for GameType::tes5se,
+  // and the game folder name LOOT created for that game type.
+  if (type && *type == "SkyrimSE" && *folder == *type) {
+    folder = "Skyrim Special Edition";
+  }
 
-          auto localPath   = gameTable["local_path"].value<std::string>();
-          auto localFolder = gameTable["local_folder"].value<std::string>();
-          if (localPath && localFolder) {
-            throw std::runtime_error(
-                "Game settings have local_path and local_folder set, use only one.");
-          } else if (localPath) {
-            newSettings.SetGameLocalPath(std::filesystem::path(*localPath));
-          } else if (localFolder) {
-            newSettings.SetGameLocalFolder(*localFolder);
-          }
+  return GameSettings(gameId, folder.value());
+}
 
-          m_GameSettings = newSettings;
-          break;
-        }
-      } catch (...) {
-        // Skip invalid games.
-      }
+void LOOTWorker::readGameSettings(const toml::table& gameTable,
+                                  loot::GameSettings& settings)
+{
+  auto name = gameTable["name"].value<std::string>();
+  if (name) {
+    settings.SetName(*name);
+  }
+
+  auto master = gameTable["master"].value<std::string>();
+  if (master) {
+    settings.SetMaster(*master);
+  }
+
+  const auto minimumHeaderVersion = gameTable["minimumHeaderVersion"].value<double>();
+  if (minimumHeaderVersion) {
+    settings.SetMinimumHeaderVersion((float)*minimumHeaderVersion);
+  }
+
+  auto source = gameTable["masterlistSource"].value<std::string>();
+  if (source) {
+    settings.SetMasterlistSource(migrateMasterlistSource(*source));
+  } else {
+    auto url    = gameTable["repo"].value<std::string>();
+    auto branch = gameTable["branch"].value<std::string>();
+    if (!url || !branch) {
+      throw std::runtime_error(
+          "'masterlistSource' and 'repo' keys both missing from game settings table");
+    }
+
+    auto migratedSource = migrateMasterlistRepoSettings(settings.Id(), *url, *branch);
+    if (migratedSource.has_value()) {
+      settings.SetMasterlistSource(migratedSource.value());
     }
   }
 
-  if (m_Language.empty()) {
-    m_Language = settings["language"].value_or(loot::MessageContent::DEFAULT_LANGUAGE);
+  auto path = gameTable["path"].value<std::string>();
+  if (path) {
+    settings.SetGamePath(std::filesystem::path(*path));
+  }
+
+  auto localPath   = gameTable["local_path"].value<std::string>();
+  auto localFolder = gameTable["local_folder"].value<std::string>();
+  if (localPath && localFolder) {
+    throw std::runtime_error(
+        "Game settings have local_path and local_folder set, use only one.");
+  } else if (localPath) {
+    settings.SetGameLocalPath(std::filesystem::path(*localPath));
+  } else if (localFolder) {
+    settings.SetGameLocalFolder(*localFolder);
   }
 }
 
@@ -456,24 +559,24 @@ LOOTWorker::migrateMasterlistRepoSettings(loot::GameId GameId, std::string url,
 
   if (oldDefaultBranches.count(branch) == 1) {
     // Update to the latest masterlist branch.
-    log(loot::LogLevel::info, "Updating masterlist repository branch from " + branch +
-                                  " to " + loot::DEFAULT_MASTERLIST_BRANCH);
+    LOOTCLI_LOG(loot::LogLevel::info, "Updating masterlist repository branch from ",
+                branch, " to ", loot::DEFAULT_MASTERLIST_BRANCH);
     branch = loot::DEFAULT_MASTERLIST_BRANCH;
   }
 
   if (GameId == loot::GameId::tes5vr && url == "https://github.com/loot/skyrimse.git") {
     // Switch to the VR-specific repository (introduced for LOOT v0.17.0).
     auto newUrl = "https://github.com/loot/skyrimvr.git";
-    log(loot::LogLevel::info,
-        "Updating masterlist repository URL from" + url + " to " + newUrl);
+    LOOTCLI_LOG(loot::LogLevel::info, "Updating masterlist repository URL from", url,
+                " to ", newUrl);
     url = newUrl;
   }
 
   if (GameId == loot::GameId::fo4vr && url == "https://github.com/loot/fallout4.git") {
     // Switch to the VR-specific repository (introduced for LOOT v0.17.0).
     auto newUrl = "https://github.com/loot/fallout4vr.git";
-    log(loot::LogLevel::info,
-        "Updating masterlist repository URL from " + url + " to " + newUrl);
+    LOOTCLI_LOG(loot::LogLevel::info, "Updating masterlist repository URL from ", url,
+                " to ", newUrl);
     url = newUrl;
   }
 
@@ -481,15 +584,14 @@ LOOTWorker::migrateMasterlistRepoSettings(loot::GameId GameId, std::string url,
   if (isLocalPath(url, filename)) {
     auto localRepoPath = std::filesystem::path(url);
     if (!isBranchCheckedOut(localRepoPath, branch)) {
-      log(loot::LogLevel::warning,
-          "The URL " + url +
-              " is a local Git repository path but the configured branch " + branch +
-              " is not checked out. LOOT will use the path as the masterlist "
-              "source, but there may be unexpected differences in the loaded "
-              "metadata if the " +
-              branch +
-              " branch is not manually checked out before the "
-              "next time the masterlist is updated.");
+      LOOTCLI_LOG(loot::LogLevel::warning, "The URL ", url,
+                  " is a local Git repository path but the configured branch ", branch,
+                  " is not checked out. LOOT will use the path as the masterlist "
+                  "source, but there may be unexpected differences in the loaded "
+                  "metadata if the ",
+                  branch,
+                  " branch is not manually checked out before the "
+                  "next time the masterlist is updated.");
     }
 
     return (localRepoPath / filename).string();
@@ -498,9 +600,9 @@ LOOTWorker::migrateMasterlistRepoSettings(loot::GameId GameId, std::string url,
   std::smatch regexMatches;
   std::regex_match(url, regexMatches, GITHUB_REPO_URL_REGEX);
   if (regexMatches.size() != 3) {
-    log(loot::LogLevel::warning,
-        "Cannot migrate masterlist repository settings as the URL does not "
-        "point to a repository on GitHub.");
+    LOOTCLI_LOG(loot::LogLevel::warning,
+                "Cannot migrate masterlist repository settings as the URL does not "
+                "point to a repository on GitHub.");
     return std::nullopt;
   }
 
@@ -526,8 +628,8 @@ std::string LOOTWorker::migrateMasterlistSource(const std::string& source)
       if (source == url) {
         const auto newSource = loot::GetDefaultMasterlistUrl(repo);
 
-        log(loot::LogLevel::info,
-            "Migrating masterlist source from " + source + " to " + newSource);
+        LOOTCLI_LOG(loot::LogLevel::info, "Migrating masterlist source from ", source,
+                    " to ", newSource);
 
         return newSource;
       }
@@ -537,56 +639,49 @@ std::string LOOTWorker::migrateMasterlistSource(const std::string& source)
   return source;
 }
 
-// executes the given function in the destructor
-//
-template <class F>
-class guard
+DownloadResult
+LOOTWorker::GetFile(const std::string& url,                 // Full URL
+                    const std::filesystem::path& fileName)  // Local file name
 {
-public:
-  guard(F f) : f_(f) {}
+  DownloadStats stats;
+  DownloadResult result;
 
-  ~guard() { f_(); }
+  {
+    const auto span = m_Trace.span("GetFile", url);
+    result          = downloadSession().download(url, fileName, &stats);
+  }
 
-private:
-  F f_;
-};
+  LOOTCLI_LOG(loot::LogLevel::info, "Masterlist is ", toString(result));
 
-void LOOTWorker::GetFile(const std::string& url,                 // Full URL
-                         const std::filesystem::path& fileName)  // Local file name
-{
-  FILE* file = fopen(fileName.string().c_str(), "wb");
-  if (!file) {
-    throw std::runtime_error("Failed to open output file: " + fileName.string());
+  if (result != DownloadResult::Fresh) {
+    LOOTCLI_LOG(loot::LogLevel::info, "Masterlist transfer: ", toString(stats));
   }
-  guard fileGuard([file] {
-    fclose(file);
-  });
 
-  CURL* curl = curl_easy_init();
-  if (!curl) {
-    throw std::runtime_error("Failed to initialize curl");
+  if (!stats.validatorsError.empty()) {
+    LOOTCLI_LOG(loot::LogLevel::warning,
+                "Failed to save the masterlist's cache validators: ",
+                stats.validatorsError);
   }
-  guard curlGuard([curl] {
-    curl_easy_cleanup(curl);
-  });
 
-  curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-  curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1);
-  curl_easy_setopt(curl, CURLOPT_WRITEDATA, file);
-  curl_easy_setopt(curl, CURLOPT_USERAGENT, "lootcli/1.5.0");
+  m_Phases.count(Progress::UpdatingMasterlist, "bytesDownloaded", stats.bytesOnWire);
+
+  return result;
+}
 
-  CURLcode res = curl_easy_perform(curl);
+DownloadSession& LOOTWorker::downloadSession()
+{
+  if (!m_Downloads) {
+    // tls sessions are kept next to the LOOT data so the next run can resume
+    // them instead of doing a full handshake
+    fs::path sessionStore;
+    if (!lootDataPath().empty()) {
+      sessionStore = lootDataPath() / "lootcli-tls-sessions";
+    }
 
-  if (res != CURLE_OK) {
-    throw std::runtime_error(std::string("curl error: ") + curl_easy_strerror(res));
+    m_Downloads = std::make_unique<DownloadSession>(sessionStore);
   }
 
-  long responseCode;
-  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &responseCode);
-  if (responseCode != 200) {
-    throw std::runtime_error("Download failed with code " +
-                             std::to_string(responseCode));
-  }
+  return *m_Downloads;
 }
 
 std::string escape(const std::string& s)
@@ -594,376 +689,1930 @@ std::string escape(const std::string& s)
   return boost::replace_all_copy(s, "\"", "\\\"");
 }
 
-int LOOTWorker::run()
+void LOOTWorker::logOverlap(std::string_view first, std::string_view second,
+                            const PhaseOverlap& o) const
 {
-  m_startTime = std::chrono::high_resolution_clock::now();
-
-  {
-    // Do some preliminary locale / UTF-8 support setup here, in case the settings file
-    // reading requires it.
-    // Boost.Locale initialisation: Specify location of language dictionaries.
-    boost::locale::generator gen;
-    gen.add_messages_path(l10nPath().string());
-    gen.add_messages_domain("loot");
-
-    // Boost.Locale initialisation: Generate and imbue locales.
-    std::locale::global(gen("en.UTF-8"));
-  }
-
-  loot::SetLoggingCallback([&](loot::LogLevel level, std::string_view message) {
-    log(level, message);
-  });
-
-  try {
-    fs::path profile(m_PluginListPath);
-    profile = profile.parent_path();
+  using std::chrono::duration_cast;
+  using std::chrono::milliseconds;
 
-    m_GameSettings = loot::GameSettings(m_GameId, loot::ToString(m_GameId));
+  const auto a     = duration_cast<milliseconds>(o.first).count();
+  const auto b     = duration_cast<milliseconds>(o.second).count();
+  const auto wall  = duration_cast<milliseconds>(o.wall).count();
+  const auto saved = std::max<long long>(0, a + b - wall);
 
-    fs::path settings = settingsPath();
-
-    if (fs::exists(settings))
-      getSettings(settings);
-
-    m_GameSettings.SetGamePath(m_GamePath);
+  LOOTCLI_LOG(loot::LogLevel::debug, first, " took ", a, "ms, ", second, " took ", b,
+              "ms, both took ", wall, "ms, running them concurrently saved ", saved,
+              "ms");
+}
 
-    std::unique_ptr<loot::GameInterface> gameHandle = CreateGameHandle(
-        m_GameSettings.Type(), m_GameSettings.GamePath(), profile.string());
+int LOOTWorker::prefetchMasterlists()
+{
+  m_Trace.reset(!m_TracePath.empty());
+  m_Phases.reset();
 
-    if (!GetLOOTAppData().empty()) {
-      // Make sure that the LOOT game path exists.
-      auto lootGamePath = gamePath();
-      if (!fs::is_directory(lootGamePath)) {
-        if (fs::exists(lootGamePath)) {
-          throw std::runtime_error(
-              "Could not create LOOT folder for game, the path exists but is not "
-              "a directory");
-        }
+  int result = 0;
 
-        std::vector<fs::path> legacyGamePaths{GetLOOTAppData() /
-                                              fs::path(m_GameSettings.FolderName())};
+  try {
+    progress(Progress::UpdatingMasterlist);
 
-        if (m_GameSettings.Id() == loot::GameId::tes5se) {
-          // LOOT v0.10.0 used SkyrimSE as its folder name for Skyrim SE, so
-          // migrate from that if it's present.
-          legacyGamePaths.insert(legacyGamePaths.begin(),
-                                 GetLOOTAppData() / "SkyrimSE");
-        }
+    std::vector<DownloadRequest> requests;
+    std::vector<std::string> folders;
+    std::set<fs::path> seen;
 
-        for (const auto& legacyGamePath : legacyGamePaths) {
-          if (fs::is_directory(legacyGamePath)) {
-            log(loot::LogLevel::info,
-                "Found a folder for this game in the LOOT data folder, "
-                "assuming "
-                "that it's a legacy game folder and moving into the correct "
-                "subdirectory...");
-
-            fs::create_directories(lootGamePath.parent_path());
-            fs::rename(legacyGamePath, lootGamePath);
-            break;
-          }
-        }
+    for (const auto& game : getAllGameSettings(settingsPath())) {
+      // same as masterlistPath() for the game
+      const auto folder = lootDataPath() / "games" / game.FolderName();
+      const auto path   = folder / "masterlist.yaml";
 
-        fs::create_directories(lootGamePath);
+      // games can share a folder
+      if (game.MasterlistSource().empty() || !seen.insert(path).second) {
+        continue;
       }
-    }
-
-    if (m_Language != loot::MessageContent::DEFAULT_LANGUAGE) {
-      log(loot::LogLevel::debug, "initialising language settings");
-      log(loot::LogLevel::debug, "selected language: " + m_Language);
-
-      // Boost.Locale initialisation: Generate and imbue locales.
-      boost::locale::generator gen;
-      std::locale::global(gen(m_Language + ".UTF-8"));
-    }
 
-    progress(Progress::CheckingMasterlistExistence);
-    if (!fs::exists(masterlistPath())) {
-      if (!m_UpdateMasterlist) {
-        log(loot::LogLevel::error,
-            "Masterlist not found at: " + masterlistPath().string());
-        return false;
-      }
-      fs::create_directories(masterlistPath().parent_path());
+      fs::create_directories(folder);
+      requests.push_back({game.MasterlistSource(), path});
+      folders.push_back(game.FolderName());
     }
 
-    if (m_UpdateMasterlist) {
-      progress(Progress::UpdatingMasterlist);
-      std::string masterlistSource = m_GameSettings.MasterlistSource();
+    LOOTCLI_LOG(loot::LogLevel::info, "updating ", requests.size(), " masterlists");
 
-      log(loot::LogLevel::info, "Downloading latest masterlist file from " +
-                                    m_GameSettings.MasterlistSource() + " to " +
-                                    masterlistPath().string());
-      using namespace std::string_literals;
-      try {
-        GetFile(masterlistSource, masterlistPath().string().c_str());
+    std::vector<DownloadOutcome> outcomes;
 
-      } catch (const std::exception& ex) {
-        log(loot::LogLevel::error, "Error downloading masterlist: "s + ex.what());
-        return false;
-      }
+    {
+      const auto span = m_Trace.span("prefetch", std::to_string(requests.size()));
+      outcomes        = downloadSession().downloadAll(requests);
     }
 
-    progress(Progress::LoadingLists);
+    for (std::size_t i = 0; i < outcomes.size(); ++i) {
+      const auto& o = outcomes[i];
 
-    gameHandle->GetDatabase().LoadMasterlist(masterlistPath().string());
-    fs::path userlist = userlistPath();
-    if (fs::exists(userlist))
-      gameHandle->GetDatabase().LoadUserlist(userlist.string());
+      if (!o.result) {
+        LOOTCLI_LOG(loot::LogLevel::error, "Error downloading masterlist for ",
+                    folders[i], ": ", o.error);
+        result = 1;
+        continue;
+      }
 
-    progress(Progress::ReadingPlugins);
-    gameHandle->LoadCurrentLoadOrderState();
-    auto loadOrder = gameHandle->GetLoadOrder();
-    std::vector<std::filesystem::path> pluginsList;
-    for (auto plugin : gameHandle->GetLoadOrder()) {
-      std::filesystem::path pluginPath(plugin);
-      pluginsList.push_back(pluginPath);
-    }
-    gameHandle->LoadPlugins(pluginsList, false);
+      LOOTCLI_LOG(loot::LogLevel::info, folders[i], " masterlist is ",
+                  toString(*o.result));
 
-    progress(Progress::SortingPlugins);
-    std::vector<std::string> sortedPlugins = gameHandle->SortPlugins(loadOrder);
+      if (*o.result != DownloadResult::Fresh) {
+        LOOTCLI_LOG(loot::LogLevel::info, folders[i],
+                    " masterlist transfer: ", toString(o.stats));
+      }
 
-    progress(Progress::WritingLoadorder);
+      if (!o.stats.validatorsError.empty()) {
+        LOOTCLI_LOG(loot::LogLevel::warning, "Failed to save the cache validators of ",
+                    folders[i], " masterlist: ", o.stats.validatorsError);
+      }
 
-    std::ofstream outf(m_PluginListPath);
-    if (!outf) {
-      log(loot::LogLevel::error,
-          "failed to open " + m_PluginListPath + " to rewrite it");
-      return 1;
+      m_Phases.count(Progress::UpdatingMasterlist, "bytesDownloaded",
+                     o.stats.bytesOnWire);
     }
-    outf << "# This file was automatically generated by Mod Organizer." << std::endl;
-    for (const std::string& plugin : sortedPlugins) {
-      outf << plugin << std::endl;
-    }
-    outf.close();
-
-    progress(Progress::ParsingLootMessages);
-    std::ofstream(m_OutputPath) << createJsonReport(*gameHandle, sortedPlugins);
-  } catch (std::system_error& e) {
-    log(loot::LogLevel::error, e.what());
-    return 1;
   } catch (const std::exception& e) {
-    log(loot::LogLevel::error, e.what());
-    return 1;
+    LOOTCLI_LOG(loot::LogLevel::error, e.what());
+    result = 1;
   }
 
   progress(Progress::Done);
+  finishRun();
 
-  return 0;
+  return result;
 }
 
-void set(QJsonObject& o, const char* e, const QJsonValue& v)
+LOOTWorker::CachedGame& LOOTWorker::prepare()
 {
-  if (v.isObject() && v.toObject().isEmpty()) {
-    return;
-  }
+  prepareSettings();
+  return cachedGame(fs::path(m_PluginListPath).parent_path());
+}
 
-  if (v.isArray() && v.toArray().isEmpty()) {
-    return;
-  }
+void LOOTWorker::prepareSettings()
+{
+  if (!m_LocaleInitialised) {
+    // Do some preliminary locale / UTF-8 support setup here, in case the settings file
+    // reading requires it.
+    // Boost.Locale initialisation: Specify location of language dictionaries.
+    boost::locale::generator gen;
+    gen.add_messages_path(l10nPath().string());
+    gen.add_messages_domain("loot");
 
-  if (v.isString() && v.toString().isEmpty()) {
-    return;
+    // Boost.Locale initialisation: Generate and imbue locales.
+    std::locale::global(gen("en.UTF-8"));
+    m_LocaleInitialised = true;
   }
 
-  o[e] = v;
-}
+  loot::SetLoggingCallback([&](loot::LogLevel level, std::string_view message) {
+    m_Trace.instant("libloot", message);
+    log(level, message);
+  });
 
-std::string
-LOOTWorker::createJsonReport(loot::GameInterface& game,
-                             const std::vector<std::string>& sortedPlugins) const
-{
-  QJsonObject root;
+  // libloot doesn't even build the messages that would be filtered out
+  loot::SetLogLevel(m_LogLevel);
 
-  set(root, "messages",
-      createMessages(game.GetDatabase().GetGeneralMessages(true, true)));
-  set(root, "plugins", createPlugins(game, sortedPlugins));
+  m_GameSettings = loot::GameSettings(m_GameId, loot::ToString(m_GameId));
 
-  const auto end = std::chrono::high_resolution_clock::now();
+  fs::path settings = settingsPath();
 
-  set(root, "stats",
-      QJsonObject{{"time", static_cast<qint64>(
-                               std::chrono::duration_cast<std::chrono::milliseconds>(
-                                   end - m_startTime)
-                                   .count())},
-                  {"lootcliVersion", LOOTCLI_VERSION_STRING},
-                  {"lootVersion", QString::fromStdString(loot::GetLiblootVersion())}});
+  if (fs::exists(settings))
+    getSettings(settings);
 
-  QJsonDocument doc(root);
-  return doc.toJson(QJsonDocument::Indented).toStdString();
-}
+  m_GameSettings.SetGamePath(m_GamePath);
 
-template <class Container>
-QJsonArray createStringArray(const Container& c)
-{
-  QJsonArray array;
+  if (!lootDataPath().empty()) {
+    // Make sure that the LOOT game path exists.
+    auto lootGamePath = gamePath();
+    if (!fs::is_directory(lootGamePath)) {
+      if (fs::exists(lootGamePath)) {
+        throw std::runtime_error(
+            "Could not create LOOT folder for game, the path exists but is not "
+            "a directory");
+      }
+
+      std::vector<fs::path> legacyGamePaths{lootDataPath() /
+                                            fs::path(m_GameSettings.FolderName())};
+
+      if (m_GameSettings.Id() == loot::GameId::tes5se) {
+        // LOOT v0.10.0 used SkyrimSE as its folder name for Skyrim SE, so
+        // migrate from that if it's present.
+        legacyGamePaths.insert(legacyGamePaths.begin(), lootDataPath() / "SkyrimSE");
+      }
 
-  for (auto&& e : c) {
-    array.push_back(QString::fromStdString(e));
+      for (const auto& legacyGamePath : legacyGamePaths) {
+        if (fs::is_directory(legacyGamePath)) {
+          LOOTCLI_LOG(loot::LogLevel::info,
+                      "Found a folder for this game in the LOOT data folder, "
+                      "assuming "
+                      "that it's a legacy game folder and moving into the correct "
+                      "subdirectory...");
+
+          fs::create_directories(lootGamePath.parent_path());
+          fs::rename(legacyGamePath, lootGamePath);
+          break;
+        }
+      }
+
+      fs::create_directories(lootGamePath);
+    }
   }
 
-  return array;
+  if (m_Language != loot::MessageContent::DEFAULT_LANGUAGE) {
+    LOOTCLI_LOG(loot::LogLevel::debug, "initialising language settings");
+    LOOTCLI_LOG(loot::LogLevel::debug, "selected language: ", m_Language);
+
+    // Boost.Locale initialisation: Generate and imbue locales.
+    boost::locale::generator gen;
+    std::locale::global(gen(m_Language + ".UTF-8"));
+  }
 }
 
-QJsonArray
-LOOTWorker::createPlugins(loot::GameInterface& game,
-                          const std::vector<std::string>& sortedPlugins) const
+int LOOTWorker::run()
 {
-  QJsonArray plugins;
+  m_Trace.reset(!m_TracePath.empty());
 
-  for (auto&& pluginName : sortedPlugins) {
+  const int r = runSort();
+  finishRun();
 
-    auto plugin = game.GetPlugin(pluginName);
+  return r;
+}
 
-    QJsonObject o;
-    o["name"] = QString::fromStdString(pluginName);
+int LOOTWorker::runBatch(const std::vector<BatchJob>& jobs)
+{
+  m_Trace.reset(!m_TracePath.empty());
 
-    if (auto metaData = game.GetDatabase().GetPluginMetadata(pluginName, true, true)) {
-      set(o, "incompatibilities",
-          createIncompatibilities(game, metaData->GetIncompatibilities()));
-      set(o, "messages", createMessages(metaData->GetMessages()));
-      set(o, "dirty", createDirty(metaData->GetDirtyInfo()));
-      set(o, "clean", createClean(metaData->GetCleanInfo()));
-    }
+  const int r = runBatchSort(jobs);
+  finishRun();
 
-    set(o, "missingMasters", createMissingMasters(game, pluginName));
+  return r;
+}
 
-    if (plugin->LoadsArchive()) {
-      o["loadsArchive"] = true;
+void LOOTWorker::finishRun()
+{
+  if (m_Trace.enabled()) {
+    try {
+      m_Trace.write(m_TracePath);
+    } catch (const std::exception& e) {
+      LOOTCLI_LOG(loot::LogLevel::warning, "failed to write trace: ", e.what());
     }
+  }
 
-    if (plugin->IsMaster()) {
-      o["isMaster"] = true;
-    }
+  // the caller may write to stdout next, such as the exit code in daemon mode
+  m_Output.flush();
+}
 
-    if (plugin->IsLightPlugin()) {
-      o["isLightMaster"] = true;
-    }
+bool LOOTWorker::checkMasterlist()
+{
+  progress(Progress::CheckingMasterlistExistence);
 
-    // don't add if the name is the only thing in there
-    if (o.size() > 1) {
-      plugins.push_back(o);
+  if (!fs::exists(masterlistPath())) {
+    if (!m_UpdateMasterlist) {
+      LOOTCLI_LOG(loot::LogLevel::error, "Masterlist not found at: ",
+                  masterlistPath().string());
+      return false;
     }
+    fs::create_directories(masterlistPath().parent_path());
   }
 
-  return plugins;
+  return true;
 }
 
-QJsonValue LOOTWorker::createMessages(const std::vector<loot::Message>& list) const
+bool LOOTWorker::downloadMasterlist()
 {
-  QJsonArray messages;
+  progress(Progress::UpdatingMasterlist);
+  std::string masterlistSource = m_GameSettings.MasterlistSource();
 
-  for (loot::Message m : list) {
-    auto simpleMessage = loot::SelectMessageContent(m.GetContent(), m_Language);
-    if (simpleMessage.has_value()) {
-      messages.push_back(QJsonObject{
-          {"type", QString::fromStdString(toString(m.GetType()))},
-          {"text", QString::fromStdString(simpleMessage.value().GetText())}});
-    }
+  LOOTCLI_LOG(loot::LogLevel::info, "Downloading latest masterlist file from ",
+              m_GameSettings.MasterlistSource(), " to ", masterlistPath().string());
+  try {
+    GetFile(masterlistSource, masterlistPath());
+  } catch (const std::exception& ex) {
+    LOOTCLI_LOG(loot::LogLevel::error, "Error downloading masterlist: ", ex.what());
+    return false;
   }
 
-  return messages;
+  return true;
 }
 
-QJsonValue
-LOOTWorker::createDirty(const std::vector<loot::PluginCleaningData>& data) const
+int LOOTWorker::runSort()
 {
-  QJsonArray array;
+  m_startTime = std::chrono::high_resolution_clock::now();
+  m_Phases.reset();
 
-  for (const auto& d : data) {
-    QJsonObject o{
-        {"crc", static_cast<qint64>(d.GetCRC())},
-        {"itm", static_cast<qint64>(d.GetITMCount())},
-        {"deletedReferences", static_cast<qint64>(d.GetDeletedReferenceCount())},
-        {"deletedNavmesh", static_cast<qint64>(d.GetDeletedNavmeshCount())},
-    };
+  try {
+    CachedGame& game = prepare();
 
-    set(o, "cleaningUtility", QString::fromStdString(d.GetCleaningUtility()));
-    auto simpleMessage = loot::SelectMessageContent(
-        loot::Message(loot::MessageType::say, d.GetDetail()).GetContent(), m_Language);
-    if (simpleMessage.has_value()) {
-      set(o, "info", QString::fromStdString(simpleMessage.value().GetText()));
-    } else {
-      set(o, "info", QString::fromStdString(""));
+    // the load order is read into the handle while the masterlist is
+    // downloaded, so it must be replaced before that
+    dropRemovedUserlist(game);
+
+    if (!checkMasterlist()) {
+      return 1;
     }
 
-    array.push_back(o);
-  }
+    // reading the load order and stamping the plugins don't depend on the
+    // masterlist, so they run while the masterlist is downloaded; the
+    // download doesn't touch the handle
+    PhaseOverlap download;
+    PluginStamps stamps;
 
-  return array;
-}
+    auto loadOrderTask = std::async(std::launch::async, [&] {
+      const auto start = Clock::now();
+      const auto span  = m_Trace.span("load order");
 
-QJsonValue
-LOOTWorker::createClean(const std::vector<loot::PluginCleaningData>& data) const
-{
-  QJsonArray array;
+      game.handle->LoadCurrentLoadOrderState();
+      auto loadOrder = game.handle->GetLoadOrder();
+      stamps         = pluginStamps(loadOrder);
 
-  for (const auto& d : data) {
-    QJsonObject o{
-        {"crc", static_cast<qint64>(d.GetCRC())},
-    };
+      download.second = Clock::now() - start;
+      return loadOrder;
+    });
 
-    set(o, "cleaningUtility", QString::fromStdString(d.GetCleaningUtility()));
-    auto simpleMessage = loot::SelectMessageContent(
-        loot::Message(loot::MessageType::say, d.GetDetail()).GetContent(), m_Language);
-    if (simpleMessage.has_value()) {
-      set(o, "info", QString::fromStdString(simpleMessage.value().GetText()));
-    } else {
-      set(o, "info", QString::fromStdString(""));
+    if (m_UpdateMasterlist) {
+      const auto start = Clock::now();
+      if (!downloadMasterlist()) {
+        return 1;
+      }
+      download.first = Clock::now() - start;
     }
 
-    array.push_back(o);
-  }
-
-  return array;
-}
+    auto loadOrder = loadOrderTask.get();
+    download.wall  = Clock::now() - download.start;
+    logOverlap("masterlist download", "load order", download);
 
-QJsonValue
-LOOTWorker::createIncompatibilities(loot::GameInterface& game,
-                                    const std::vector<loot::File>& data) const
-{
-  QJsonArray array;
+    const auto current = fingerprints(game, loadOrder, stamps);
 
-  for (auto&& f : data) {
-    const auto n = static_cast<std::string>(f.GetName());
-    if (!game.GetPlugin(n)) {
-      continue;
+    if (useCachedResults(current)) {
+      progress(Progress::Done);
+      return 0;
     }
 
-    const auto name        = QString::fromStdString(n);
-    const auto displayName = QString::fromStdString(f.GetDisplayName());
-
-    QJsonObject o{{"name", name}};
+    // libloot doesn't document LoadLists() and LoadPlugins() as safe to call
+    // concurrently on a handle, so the lists are loaded before the plugins
+    progress(Progress::LoadingLists);
 
-    if (displayName != name) {
-      set(o, "displayName", displayName);
+    {
+      const auto span = m_Trace.span("load lists");
+      loadLists(game);
     }
 
-    array.push_back(std::move(o));
-  }
+    progress(Progress::ReadingPlugins);
 
-  return array;
-}
+    {
+      const auto span = m_Trace.span("load plugins");
+      ProgressMeter pluginsMeter(m_Output, Progress::ReadingPlugins, 0);
+      loadPlugins(game, loadOrder, stamps, pluginsMeter);
+    }
 
-QJsonValue LOOTWorker::createMissingMasters(loot::GameInterface& game,
-                                            const std::string& pluginName) const
-{
-  QJsonArray array;
+    {
+      const auto loaded = game.handle->GetLoadedPlugins();
+      const auto light  = std::count_if(loaded.begin(), loaded.end(), [](auto&& p) {
+        return p && p->IsLightPlugin();
+      });
 
-  for (auto&& master : game.GetPlugin(pluginName)->GetMasters()) {
-    if (!game.GetPlugin(master)) {
-      array.push_back(QString::fromStdString(master));
+      m_Phases.count(Progress::ReadingPlugins, "pluginsLoaded",
+                     static_cast<std::int64_t>(loaded.size()));
+      m_Phases.count(Progress::ReadingPlugins, "lightPlugins", light);
     }
-  }
 
-  return array;
-}
+    progress(Progress::SortingPlugins);
+    std::vector<std::string> sortedPlugins = sortPlugins(game, loadOrder, current);
+    m_Phases.count(Progress::SortingPlugins, "pluginsSorted",
+                   static_cast<std::int64_t>(sortedPlugins.size()));
+
+    progress(Progress::WritingLoadorder);
+    const bool loadOrderChanged = writeLoadOrder(m_PluginListPath, sortedPlugins);
+
+    progress(Progress::ParsingLootMessages);
+    ProgressMeter reportMeter(m_Output, Progress::ParsingLootMessages,
+                              static_cast<std::int64_t>(sortedPlugins.size()));
+
+    writeReport(*game.handle, sortedPlugins,
+                {m_OutputPath, loadOrderChanged, m_Threads, reportMeter, m_Delta});
+
+    if (!m_Delta) {
+      // the state would be older than the report, the next delta would be
+      // against the wrong sort
+      std::error_code ec;
+      fs::remove(profileStatePath() / "delta", ec);
+    }
+
+    saveCachedResults(game, sortedPlugins);
+  } catch (std::system_error& e) {
+    LOOTCLI_LOG(loot::LogLevel::error, e.what());
+    return 1;
+  } catch (const std::exception& e) {
+    LOOTCLI_LOG(loot::LogLevel::error, e.what());
+    return 1;
+  }
+
+  progress(Progress::Done);
+
+  return 0;
+}
+
+// calls f(i) for every i in [0, count) on up to the given number of threads;
+// a thread takes the next index as soon as it's done with one, so a few slow
+// items don't hold up the others; the first exception is rethrown once all
+// threads have stopped
+//
+template <class F>
+void parallelFor(std::size_t count, unsigned int threads, F&& f)
+{
+  threads = static_cast<unsigned int>(std::min<std::size_t>(threads, count));
+
+  if (threads <= 1) {
+    for (std::size_t i = 0; i < count; ++i) {
+      f(i);
+    }
+
+    return;
+  }
+
+  std::atomic<std::size_t> next = 0;
+  std::exception_ptr error;
+  std::mutex errorMutex;
+
+  {
+    std::vector<std::jthread> workers;
+
+    for (unsigned int t = 0; t < threads; ++t) {
+      workers.emplace_back([&] {
+        for (auto i = next++; i < count; i = next++) {
+          try {
+            f(i);
+          } catch (...) {
+            std::scoped_lock lock(errorMutex);
+            if (!error) {
+              error = std::current_exception();
+            }
+
+            // makes the other threads stop too
+            next = count;
+          }
+        }
+      });
+    }
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+// files of a profile that libloot reads the load order from
+const std::array<const char*, 2> LOAD_ORDER_FILES = {"plugins.txt", "loadorder.txt"};
+
+// profiles with the same hash have the same load order
+//
+std::uint64_t hashLoadOrderFiles(const fs::path& profile)
+{
+  auto hash = EMPTY_HASH;
+
+  for (const auto* name : LOAD_ORDER_FILES) {
+    hash = hashBytes(name, hash);
+
+    if (fs::exists(profile / name)) {
+      hash = hashFile(profile / name, hash);
+    } else {
+      hash = hashBytes("missing", hash);
+    }
+  }
+
+  return hash;
+}
+
+int LOOTWorker::runBatchSort(const std::vector<BatchJob>& jobs)
+{
+  m_startTime = std::chrono::high_resolution_clock::now();
+  m_Phases.reset();
+
+  // jobs whose profiles have the same load order get the same results, so
+  // only one job of each group is sorted
+  struct Group
+  {
+    fs::path profile;
+
+    // the load order files before the sort, the sort and the report use
+    // these like a single sort would, even once the sorted order is written
+    LoadOrderFiles files;
+
+    std::vector<std::size_t> jobs;
+    std::vector<std::string> loadOrder;
+    std::vector<std::string> sorted;
+    bool loadOrderChanged = false;
+    bool failed           = false;
+  };
+
+  // a game handle and the groups it sorts, one after another
+  struct Sorter
+  {
+    CachedGame* game = nullptr;
+    std::vector<std::size_t> groups;
+    std::vector<std::string> plugins;
+    std::int64_t size = 0;
+  };
+
+  int result = 0;
+
+  if (m_Delta) {
+    LOOTCLI_LOG(loot::LogLevel::warning, "--delta is ignored with --batch");
+  }
+
+  try {
+    prepareSettings();
+
+    if (!checkMasterlist()) {
+      return 1;
+    }
+
+    if (m_UpdateMasterlist && !downloadMasterlist()) {
+      return 1;
+    }
+
+    std::vector<Group> groups;
+    std::map<std::uint64_t, std::size_t> groupIndex;
+
+    for (std::size_t i = 0; i < jobs.size(); ++i) {
+      const auto profile = fs::path(jobs[i].pluginListPath).parent_path();
+      const auto [itor, added] =
+          groupIndex.emplace(hashLoadOrderFiles(profile), groups.size());
+
+      if (added) {
+        groups.push_back({profile, readLoadOrderFiles(profile), {}, {}, {}});
+      }
+
+      groups[itor->second].jobs.push_back(i);
+
+      // the load order and report of the profile are about to be replaced, so
+      // the next single sort must not reuse its results or diff against them
+      const auto state = profileStatePath(profile);
+      for (const auto* name : {"fingerprint", "sort-fingerprint", "delta"}) {
+        std::error_code ec;
+        fs::remove(state / name, ec);
+      }
+    }
+
+    LOOTCLI_LOG(loot::LogLevel::info, jobs.size(), " jobs with ", groups.size(),
+                " distinct load orders");
+
+    m_Phases.count(Progress::SortingPlugins, "jobs",
+                   static_cast<std::int64_t>(jobs.size()));
+    m_Phases.count(Progress::SortingPlugins, "distinctLoadOrders",
+                   static_cast<std::int64_t>(groups.size()));
+
+    // libloot evaluates conditions against the load order of a handle, so
+    // load orders can only be sorted concurrently on separate handles; each
+    // has a profile folder of its own that a group's load order files are
+    // copied to when its load order is needed
+    std::vector<Sorter> sorters(std::clamp<std::size_t>(groups.size(), 1, m_Threads));
+
+    for (std::size_t k = 0; k < sorters.size(); ++k) {
+      const auto scratch = gamePath() / "lootcli" / "batch" / std::to_string(k);
+      fs::create_directories(scratch);
+
+      sorters[k].game = &cachedGame(scratch);
+      dropRemovedUserlist(*sorters[k].game);
+    }
+
+    for (auto& group : groups) {
+      useLoadOrderOf(*sorters.front().game, group.files);
+      group.loadOrder = sorters.front().game->handle->GetLoadOrder();
+    }
+
+    // the biggest remaining load order always goes to the handle with the
+    // fewest plugins so far, ties are broken by the order of the jobs
+    std::vector<std::size_t> bySize(groups.size());
+    std::iota(bySize.begin(), bySize.end(), std::size_t(0));
+
+    std::stable_sort(bySize.begin(), bySize.end(), [&](auto&& a, auto&& b) {
+      return groups[a].loadOrder.size() > groups[b].loadOrder.size();
+    });
+
+    for (const auto g : bySize) {
+      auto& sorter = *std::min_element(sorters.begin(), sorters.end(),
+                                       [](auto&& a, auto&& b) {
+                                         return a.size < b.size;
+                                       });
+
+      sorter.groups.push_back(g);
+      sorter.size += static_cast<std::int64_t>(groups[g].loadOrder.size());
+    }
+
+    // every plugin of the groups of a handle, each loaded once by it; plugins
+    // shared with the groups of other handles are loaded by those too
+    for (auto& sorter : sorters) {
+      std::sort(sorter.groups.begin(), sorter.groups.end());
+
+      std::set<std::string> seen;
+      for (const auto g : sorter.groups) {
+        for (const auto& plugin : groups[g].loadOrder) {
+          if (seen.insert(plugin).second) {
+            sorter.plugins.push_back(plugin);
+          }
+        }
+      }
+    }
+
+    // each handle loads its lists before its plugins, see runSort(); the
+    // plugins are stamped meanwhile, which doesn't touch the handles
+    progress(Progress::LoadingLists);
+
+    auto stampsTask = std::async(std::launch::async, [&] {
+      std::vector<PluginStamps> stamps;
+      for (const auto& sorter : sorters) {
+        stamps.push_back(pluginStamps(sorter.plugins));
+      }
+
+      return stamps;
+    });
+
+    {
+      const auto span = m_Trace.span("load lists");
+      parallelFor(sorters.size(), static_cast<unsigned int>(sorters.size()),
+                  [&](std::size_t k) {
+                    loadLists(*sorters[k].game);
+                  });
+    }
+
+    const auto stamps = stampsTask.get();
+
+    progress(Progress::ReadingPlugins);
+
+    {
+      const auto span = m_Trace.span("load plugins");
+      ProgressMeter pluginsMeter(m_Output, Progress::ReadingPlugins, 0);
+
+      parallelFor(sorters.size(), static_cast<unsigned int>(sorters.size()),
+                  [&](std::size_t k) {
+                    loadPlugins(*sorters[k].game, sorters[k].plugins, stamps[k],
+                                pluginsMeter);
+                  });
+    }
+
+    // calls f(group, game) for the groups that haven't failed yet, the
+    // handles run concurrently; a group that fails doesn't stop the others
+    const auto forEachGroup = [&](auto&& f) {
+      parallelFor(sorters.size(), static_cast<unsigned int>(sorters.size()),
+                  [&](std::size_t k) {
+                    for (const auto g : sorters[k].groups) {
+                      auto& group = groups[g];
+                      if (group.failed) {
+                        continue;
+                      }
+
+                      try {
+                        f(group, *sorters[k].game);
+                      } catch (const std::exception& e) {
+                        LOOTCLI_LOG(loot::LogLevel::error,
+                                    jobs[group.jobs.front()].pluginListPath, ": ",
+                                    e.what());
+                        group.failed = true;
+                      }
+                    }
+                  });
+    };
+
+    progress(Progress::SortingPlugins);
+    forEachGroup([&](Group& group, CachedGame& game) {
+      const auto span = m_Trace.span("sort", group.profile.string());
+
+      useLoadOrderOf(game, group.files);
+      group.sorted = game.handle->SortPlugins(group.loadOrder);
+
+      m_Phases.count(Progress::SortingPlugins, "pluginsSorted",
+                     static_cast<std::int64_t>(group.sorted.size()));
+    });
+
+    // the jobs of a group have the same load order file, so it's changed for
+    // all of them or none
+    progress(Progress::WritingLoadorder);
+    for (auto& group : groups) {
+      if (group.failed) {
+        continue;
+      }
+
+      try {
+        for (const auto i : group.jobs) {
+          group.loadOrderChanged |=
+              writeLoadOrder(jobs[i].pluginListPath, group.sorted);
+        }
+      } catch (const std::exception& e) {
+        LOOTCLI_LOG(loot::LogLevel::error, jobs[group.jobs.front()].pluginListPath,
+                    ": ", e.what());
+        group.failed = true;
+      }
+    }
+
+    progress(Progress::ParsingLootMessages);
+
+    ProgressMeter reportMeter(m_Output, Progress::ParsingLootMessages, 0);
+    for (const auto& group : groups) {
+      if (!group.failed) {
+        reportMeter.addTotal(static_cast<std::int64_t>(group.sorted.size()));
+      }
+    }
+
+    // the threads are shared by the reports written at the same time
+    const auto reportThreads = std::max<unsigned int>(
+        1, m_Threads / static_cast<unsigned int>(sorters.size()));
+
+    forEachGroup([&](Group& group, CachedGame& game) {
+      const auto& first = jobs[group.jobs.front()];
+
+      // metadata conditions are evaluated against the load order of the
+      // handle; a single sort writes its report with the load order it read
+      // before sorting, so this gives the handle the same one
+      useLoadOrderOf(game, group.files);
+
+      writeReport(*game.handle, group.sorted,
+                  {first.out, group.loadOrderChanged, reportThreads, reportMeter,
+                   false});
+
+      if (group.jobs.size() > 1) {
+        std::ifstream in(first.out, std::ios::binary);
+        const std::string report(std::istreambuf_iterator<char>(in), {});
+
+        if (in.bad()) {
+          throw std::runtime_error("failed to read " + first.out);
+        }
+
+        // the other jobs' reports are replaced like the first one's, so a
+        // reader never sees a partial one
+        for (const auto i : group.jobs) {
+          if (i != group.jobs.front()) {
+            AtomicFile file(jobs[i].out);
+            file.write(report);
+            file.commit();
+          }
+        }
+      }
+    });
+
+    for (const auto& group : groups) {
+      if (group.failed) {
+        result = 1;
+      }
+    }
+  } catch (const std::exception& e) {
+    LOOTCLI_LOG(loot::LogLevel::error, e.what());
+    return 1;
+  }
+
+  progress(Progress::Done);
+
+  return result;
+}
+
+LOOTWorker::LoadOrderFiles
+LOOTWorker::readLoadOrderFiles(const fs::path& profile) const
+{
+  LoadOrderFiles files;
+
+  for (std::size_t i = 0; i < LOAD_ORDER_FILES.size(); ++i) {
+    const auto path = profile / LOAD_ORDER_FILES[i];
+
+    if (fs::exists(path)) {
+      std::ifstream in(path, std::ios::binary);
+      files[i] = std::string(std::istreambuf_iterator<char>(in), {});
+
+      if (in.bad()) {
+        throw std::runtime_error("failed to read " + path.string());
+      }
+    }
+  }
+
+  return files;
+}
+
+void LOOTWorker::useLoadOrderOf(CachedGame& game, const LoadOrderFiles& files)
+{
+  for (std::size_t i = 0; i < LOAD_ORDER_FILES.size(); ++i) {
+    const auto path = game.profile / LOAD_ORDER_FILES[i];
+
+    if (files[i]) {
+      std::ofstream out(path, std::ios::binary | std::ios::trunc);
+      out << *files[i];
+
+      if (!out) {
+        throw std::runtime_error("failed to write " + path.string());
+      }
+    } else {
+      fs::remove(path);
+    }
+  }
+
+  game.handle->LoadCurrentLoadOrderState();
+}
+
+// the file used to be written in text mode, which has crlf line endings on
+// windows
+#ifdef _WIN32
+constexpr std::string_view LOAD_ORDER_NEWLINE = "\r\n";
+#else
+constexpr std::string_view LOAD_ORDER_NEWLINE = "\n";
+#endif
+
+bool LOOTWorker::writeLoadOrder(const std::string& path,
+                                const std::vector<std::string>& sortedPlugins) const
+{
+  std::string content = "# This file was automatically generated by Mod Organizer.";
+  content += LOAD_ORDER_NEWLINE;
+
+  for (const std::string& plugin : sortedPlugins) {
+    content += plugin;
+    content += LOAD_ORDER_NEWLINE;
+  }
+
+  // rewriting the file with the same content would still wake up anything
+  // watching it, such as MO2
+  std::error_code ec;
+  if (fs::file_size(path, ec) == content.size() && !ec) {
+    std::ifstream in(path, std::ios::binary);
+    std::string old(content.size(), '\0');
+
+    if (in.read(old.data(), static_cast<std::streamsize>(old.size())) &&
+        old == content) {
+      LOOTCLI_LOG(loot::LogLevel::debug, "load order is unchanged, not rewriting ",
+                  path);
+      return false;
+    }
+  }
+
+  AtomicFile file(path, true);
+  file.write(content);
+  file.commit();
+
+  return true;
+}
+
+LOOTWorker::CachedGame& LOOTWorker::cachedGame(const fs::path& profile)
+{
+  const auto key = loot::ToString(m_GameSettings.Id()) + "|" +
+                   m_GameSettings.GamePath().string() + "|" + profile.string();
+
+  auto& game = m_Games[key];
+
+  if (!game.handle) {
+    game.profile = profile;
+    game.handle  = CreateGameHandle(m_GameSettings.Type(), m_GameSettings.GamePath(),
+                                    profile.string());
+  } else {
+    LOOTCLI_LOG(loot::LogLevel::debug, "reusing game handle for ", key);
+  }
+
+  return game;
+}
+
+std::optional<FileStamp> getFileStamp(const fs::path& path)
+{
+  std::error_code ec;
+
+  const auto size = fs::file_size(path, ec);
+  if (ec) {
+    return {};
+  }
+
+  const auto time = fs::last_write_time(path, ec);
+  if (ec) {
+    return {};
+  }
+
+  std::uint64_t inode = 0;
+
+#ifndef _WIN32
+  struct stat st;
+  if (::stat(path.c_str(), &st) == 0) {
+    inode = static_cast<std::uint64_t>(st.st_ino);
+  }
+#endif
+
+  return FileStamp{size, time, inode};
+}
+
+std::uint64_t LOOTWorker::listsHash(CachedGame& game) const
+{
+  const auto masterlist = getFileStamp(masterlistPath());
+  const auto userlist   = getFileStamp(userlistPath());
+
+  if (game.hashedLists && game.hashedMasterlist == masterlist &&
+      game.hashedUserlist == userlist) {
+    return *game.hashedLists;
+  }
+
+  auto hash = hashBytes(loot::GetLiblootVersion());
+  hash      = hashFile(masterlistPath(), hash);
+
+  // separates the files so moving content from one to the other changes the hash
+  hash = hashBytes("|", hash);
+  hash = hashFile(userlistPath(), hash);
+
+  game.hashedMasterlist = masterlist;
+  game.hashedUserlist   = userlist;
+  game.hashedLists      = hash;
+
+  return hash;
+}
+
+void LOOTWorker::dropRemovedUserlist(CachedGame& game)
+{
+  if (game.userlist && !fs::exists(userlistPath())) {
+    // a userlist cannot be unloaded, so start over with a fresh handle
+    LOOTCLI_LOG(loot::LogLevel::debug, "userlist was removed, recreating game handle");
+
+    game.handle = CreateGameHandle(m_GameSettings.Type(), m_GameSettings.GamePath(),
+                                   game.profile.string());
+    game.masterlist.reset();
+    game.userlist.reset();
+    game.plugins.clear();
+  }
+}
+
+void LOOTWorker::loadLists(CachedGame& game)
+{
+  const auto masterlist = getFileStamp(masterlistPath());
+  const auto userlist   = getFileStamp(userlistPath());
+
+  if (game.masterlist && game.masterlist == masterlist && game.userlist == userlist) {
+    LOOTCLI_LOG(loot::LogLevel::debug,
+                "masterlist and userlist are unchanged, not reloading");
+    return;
+  }
+
+  // the files are often rewritten with the same content, such as when the
+  // masterlist is downloaded again, so the content decides whether to reparse
+  const auto hash = listsHash(game);
+
+  if (game.masterlist && game.listsHash == hash &&
+      game.userlist.has_value() == userlist.has_value()) {
+    LOOTCLI_LOG(loot::LogLevel::debug,
+                "masterlist and userlist content is unchanged, not reloading");
+
+    game.masterlist = masterlist;
+    game.userlist   = userlist;
+    return;
+  }
+
+  game.masterlist.reset();
+  game.userlist.reset();
+
+  game.handle->GetDatabase().LoadMasterlist(masterlistPath().string());
+  game.masterlist = masterlist;
+  game.listsHash  = hash;
+
+  if (userlist) {
+    game.handle->GetDatabase().LoadUserlist(userlistPath().string());
+    game.userlist = userlist;
+  }
+}
+
+std::optional<FileStamp> LOOTWorker::pluginStamp(const std::string& pluginName) const
+{
+  const auto path = dataPath() / fs::path(pluginName);
+
+  if (auto stamp = getFileStamp(path)) {
+    return stamp;
+  }
+
+  // libloot also loads ghosted plugins
+  return getFileStamp(fs::path(path).concat(".ghost"));
+}
+
+void LOOTWorker::loadPluginFiles(
+    loot::GameInterface& game, const std::vector<std::string>& plugins,
+    const PluginStamps& stamps, ProgressMeter& meter) const
+{
+  const auto fileSize = [&](const std::string& plugin) -> std::int64_t {
+    const auto itor = stamps.find(plugin);
+    if (itor == stamps.end() || !itor->second) {
+      return 0;
+    }
+
+    return static_cast<std::int64_t>(itor->second->size);
+  };
+
+  // libloot loads the plugins of a call in parallel and concurrent calls on
+  // the same handle aren't documented as safe, so the plugins are loaded in
+  // calls one after the other; each is a batch of about the same size so the
+  // progress moves evenly, big enough for libloot to still use its threads
+  const std::size_t minBatch = 32;
+  const std::size_t maxBatch = 64;
+
+  std::int64_t total = 0;
+  for (const auto& plugin : plugins) {
+    total += fileSize(plugin);
+  }
+
+  const auto batches =
+      std::max<std::size_t>(1, plugins.size() * 2 / (minBatch + maxBatch));
+  const auto target = total / static_cast<std::int64_t>(batches);
+
+  // batches are in load order, so masters are loaded before or with the
+  // plugins that need them, which starfield requires
+  std::vector<std::filesystem::path> batch;
+  std::int64_t bytes = 0;
+
+  for (std::size_t i = 0; i < plugins.size(); ++i) {
+    batch.push_back(std::filesystem::path(plugins[i]));
+    bytes += fileSize(plugins[i]);
+
+    const bool full = batch.size() >= maxBatch ||
+                      (batch.size() >= minBatch && bytes >= target);
+
+    if (full || i + 1 == plugins.size()) {
+      game.LoadPlugins(batch, false);
+      meter.add(static_cast<std::int64_t>(batch.size()), bytes);
+
+      batch.clear();
+      bytes = 0;
+    }
+  }
+}
+
+LOOTWorker::PluginStamps
+LOOTWorker::pluginStamps(const std::vector<std::string>& loadOrder) const
+{
+  PluginStamps stamps;
+  for (const auto& plugin : loadOrder) {
+    stamps.emplace(plugin, pluginStamp(plugin));
+  }
+
+  return stamps;
+}
+
+void LOOTWorker::loadPlugins(CachedGame& game,
+                             const std::vector<std::string>& loadOrder,
+                             const PluginStamps& stamps, ProgressMeter& meter)
+{
+  const bool removed =
+      std::any_of(game.plugins.begin(), game.plugins.end(), [&](auto&& p) {
+        return !stamps.contains(p.first);
+      });
+
+  if (removed) {
+    // plugins that are not in the load order anymore must not be found by the
+    // report, so everything is reloaded
+    LOOTCLI_LOG(loot::LogLevel::debug, "plugins were removed, reloading all plugins");
+    game.handle->ClearLoadedPlugins();
+    game.plugins.clear();
+  }
+
+  std::vector<std::string> changed;
+  for (const auto& plugin : loadOrder) {
+    auto itor = game.plugins.find(plugin);
+
+    // plugins that could not be stamped are always reloaded
+    if (itor == game.plugins.end() || !itor->second ||
+        itor->second != stamps.at(plugin)) {
+      changed.push_back(plugin);
+    }
+  }
+
+  if (game.plugins.empty()) {
+    LOOTCLI_LOG(loot::LogLevel::debug, "loading ", changed.size(), " plugins");
+  } else {
+    LOOTCLI_LOG(loot::LogLevel::debug, "reloading ", changed.size(),
+                " changed plugins out of ", loadOrder.size());
+  }
+
+  if (changed.empty()) {
+    return;
+  }
+
+  // forget the stamps until the plugins have actually been loaded, so a failed
+  // load is retried by the next run
+  for (const auto& plugin : changed) {
+    game.plugins.erase(plugin);
+  }
+
+  meter.addTotal(static_cast<std::int64_t>(changed.size()));
+  loadPluginFiles(*game.handle, changed, stamps, meter);
+  m_Phases.count(Progress::ReadingPlugins, "pluginsRead",
+                 static_cast<std::int64_t>(changed.size()));
+
+  for (const auto& plugin : changed) {
+    game.plugins[plugin] = stamps.at(plugin);
+  }
+}
+
+int LOOTWorker::checkFingerprint()
+{
+  try {
+    CachedGame& game = prepare();
+
+    game.handle->LoadCurrentLoadOrderState();
+    const auto loadOrder = game.handle->GetLoadOrder();
+    const auto current   = fingerprints(game, loadOrder, pluginStamps(loadOrder)).run;
+    const auto state   = profileStatePath();
+
+    const bool upToDate = readFingerprint(state / "fingerprint") == current &&
+                          fs::exists(state / "report");
+
+    m_Output.pushAndFlush("[fingerprint] " + current +
+                          (upToDate ? " current" : " stale") + "\n");
+  } catch (const std::exception& e) {
+    LOOTCLI_LOG(loot::LogLevel::error, e.what());
+    m_Output.flush();
+    return 1;
+  }
+
+  return 0;
+}
+
+std::vector<PhaseStats> LOOTWorker::phases() const
+{
+  return m_Phases.snapshot();
+}
+
+LogSink& LOOTWorker::output()
+{
+  return m_Output;
+}
+
+const LogSink& LOOTWorker::output() const
+{
+  return m_Output;
+}
+
+LOOTWorker::Fingerprints
+LOOTWorker::fingerprints(CachedGame& game, const std::vector<std::string>& loadOrder,
+                         const PluginStamps& stamps) const
+{
+  auto hashValue = [](auto value, std::uint64_t hash) {
+    return hashBytes({reinterpret_cast<const char*>(&value), sizeof(value)}, hash);
+  };
+
+  // anything that changes the sorted order must be in here
+  auto hash = hashBytes(loot::ToString(m_GameSettings.Id()));
+  hash      = hashBytes(m_GameSettings.GamePath().string(), hash);
+  hash      = hashValue(listsHash(game), hash);
+
+  // libloot reads the load order from both files, plugins.txt also has
+  // which plugins are active
+  const auto profile = fs::path(m_PluginListPath).parent_path();
+  hash               = hashValue(hashLoadOrderFiles(profile), hash);
+
+  for (const auto& plugin : loadOrder) {
+    hash = hashBytes(plugin, hash);
+
+    if (const auto& stamp = stamps.at(plugin)) {
+      hash = hashValue(stamp->size, hash);
+      hash = hashValue(stamp->time.time_since_epoch().count(), hash);
+      hash = hashValue(stamp->inode, hash);
+    } else {
+      hash = hashBytes("missing", hash);
+    }
+  }
+
+  Fingerprints f;
+  f.sort = toHex(hash);
+
+  // the report also depends on these
+  hash  = hashBytes(LOOTCLI_VERSION_STRING, hash);
+  hash  = hashBytes(m_Language, hash);
+  hash  = hashBytes(reportFormatToString(m_ReportFormat), hash);
+  hash  = hashBytes(m_MessageTable ? "table" : "inline", hash);
+  f.run = toHex(hash);
+
+  return f;
+}
+
+fs::path LOOTWorker::profileStatePath() const
+{
+  return profileStatePath(fs::path(m_PluginListPath).parent_path());
+}
+
+fs::path LOOTWorker::profileStatePath(const fs::path& profile) const
+{
+  // one folder per profile, named after a hash of the profile's path
+  return gamePath() / "lootcli" / toHex(hashBytes(profile.string()));
+}
+
+std::string LOOTWorker::readFingerprint(const fs::path& file) const
+{
+  std::string s;
+  std::ifstream(file) >> s;
+  return s;
+}
+
+bool LOOTWorker::useCachedResults(const Fingerprints& current)
+{
+  const auto state = profileStatePath();
+
+  std::error_code ec;
+
+  if (readFingerprint(state / "fingerprint") != current.run) {
+    // the results are about to be replaced, a failed sort must not leave a
+    // fingerprint that matches the old ones
+    fs::remove(state / "fingerprint", ec);
+    return false;
+  }
+
+  fs::copy_file(state / "report", m_OutputPath,
+                fs::copy_options::overwrite_existing, ec);
+
+  if (ec) {
+    LOOTCLI_LOG(loot::LogLevel::warning, "failed to use cached report, sorting again: ",
+                ec.message());
+    return false;
+  }
+
+  LOOTCLI_LOG(loot::LogLevel::info,
+              "nothing has changed since the last sort, using its results");
+
+  if (m_Delta) {
+    try {
+      writeDelta(m_OutputPath, readDeltaState(state / "delta", deltaTag()), nullptr,
+                 nullptr);
+    } catch (const std::exception& e) {
+      LOOTCLI_LOG(loot::LogLevel::warning, "failed to write delta, sorting again: ",
+                  e.what());
+      return false;
+    }
+  }
+
+  return true;
+}
+
+std::vector<std::string>
+LOOTWorker::sortPlugins(CachedGame& game, const std::vector<std::string>& loadOrder,
+                        const Fingerprints& current)
+{
+  // libloot can only sort the whole load order, but if the sorting inputs are
+  // the same as after the last sort, the load order is that sort's result;
+  // this is reached when only what the report depends on changed, such as
+  // the language, since identical inputs reuse the whole report before
+  // anything is loaded
+  if (readFingerprint(profileStatePath() / "sort-fingerprint") != current.sort) {
+    return game.handle->SortPlugins(loadOrder);
+  }
+
+  LOOTCLI_LOG(loot::LogLevel::info,
+              "sorting inputs are unchanged since the last sort, keeping the load "
+              "order");
+
+  if (!m_VerifyIncremental) {
+    return loadOrder;
+  }
+
+  auto sorted = game.handle->SortPlugins(loadOrder);
+
+  if (sorted == loadOrder) {
+    LOOTCLI_LOG(loot::LogLevel::info, "kept load order verified against a full sort");
+    return sorted;
+  }
+
+  const auto [a, b] = std::mismatch(loadOrder.begin(), loadOrder.end(),
+                                    sorted.begin(), sorted.end());
+
+  LOOTCLI_LOG(loot::LogLevel::warning,
+              "kept load order differs from a full sort at position ",
+              a - loadOrder.begin(), ": ", (a != loadOrder.end() ? *a : "<end>"),
+              " instead of ", (b != sorted.end() ? *b : "<end>"),
+              ", using the full sort");
+
+  return sorted;
+}
+
+void LOOTWorker::saveCachedResults(CachedGame& game,
+                                   const std::vector<std::string>& sortedPlugins)
+{
+  try {
+    // the load order file was just rewritten, so the fingerprints must be the
+    // ones the next run will see
+    game.handle->LoadCurrentLoadOrderState();
+    const auto loadOrder = game.handle->GetLoadOrder();
+    const auto current   = fingerprints(game, loadOrder, pluginStamps(loadOrder));
+
+    const auto state = profileStatePath();
+    fs::create_directories(state);
+
+    fs::copy_file(m_OutputPath, state / "report",
+                  fs::copy_options::overwrite_existing);
+    std::ofstream(state / "fingerprint") << current.run << "\n";
+
+    // some games keep the load order in a file lootcli doesn't write, the
+    // load order can only be kept next time if it really is the sorted one
+    if (loadOrder == sortedPlugins) {
+      std::ofstream(state / "sort-fingerprint") << current.sort << "\n";
+    } else {
+      fs::remove(state / "sort-fingerprint");
+    }
+  } catch (const std::exception& e) {
+    LOOTCLI_LOG(loot::LogLevel::warning, "failed to save results for the next sort: ",
+                e.what());
+  }
+}
+
+// calls f with a writer of the given format that appends to out, see
+// JsonWriter for depth
+//
+template <class F>
+void withReportWriter(ReportFormat format, std::string& out, int depth,
+                      std::pmr::memory_resource* scratch, F&& f)
+{
+  if (format == ReportFormat::Cbor) {
+    CborWriter w(out);
+    f(w);
+  } else {
+    JsonWriter w(out, depth, format == ReportFormat::JsonCompact, scratch);
+    f(w);
+  }
+}
+
+void LOOTWorker::writeReport(loot::GameInterface& game,
+                             const std::vector<std::string>& sortedPlugins,
+                             const ReportJob& job) const
+{
+  // every plugin, master and incompatibility of the report is looked up in
+  // here instead of libloot
+  const PluginIndex index(game.GetLoadedPlugins());
+  MessageCache messages(m_Language);
+
+  ReportContext cx{game, index, messages, job};
+
+  DeltaState current;
+  if (job.delta) {
+    current.order = sortedPlugins;
+    cx.delta      = &current;
+  }
+
+  AtomicFile file(job.out);
+  std::string buffer;
+
+  withReportWriter(m_ReportFormat, buffer, 0, std::pmr::get_default_resource(),
+                   [&](ReportWriter& w) {
+                     writeRoot(w, buffer, file, cx, sortedPlugins);
+                   });
+
+  file.write(buffer);
+  file.commit();
+
+  if (!job.delta) {
+    return;
+  }
+
+  // only compared, so the separators just have to be something that's not in
+  // a message
+  for (const auto& m : cx.generalMessages) {
+    const auto& e = cx.messages.resolve(m.GetType(), m.GetContent());
+    if (e.found) {
+      current.messages += e.type;
+      current.messages += '\0';
+      current.messages += e.text;
+      current.messages += '\0';
+    }
+  }
+
+  const auto state = profileStatePath() / "delta";
+
+  writeDelta(job.out, readDeltaState(state, deltaTag()), &current, &cx);
+
+  fs::create_directories(state.parent_path());
+  writeDeltaState(state, deltaTag(), current);
+}
+
+std::string LOOTWorker::deltaTag() const
+{
+  const auto messages = m_MessageTable ? " table-ids " : " inline ";
+  return reportFormatToString(m_ReportFormat) + messages + LOOTCLI_VERSION_STRING;
+}
+
+void LOOTWorker::writeDelta(const std::string& out,
+                            const std::optional<DeltaState>& previous,
+                            const DeltaState* current, ReportContext* cx) const
+{
+  std::string buffer;
+
+  withReportWriter(m_ReportFormat, buffer, 0, std::pmr::get_default_resource(),
+                   [&](ReportWriter& w) {
+                     w.beginDocument();
+                     w.beginObject();
+
+                     if (!previous) {
+                       w.member("full", true);
+                     } else if (current) {
+                       writeDeltaMembers(w, *cx, *previous, *current);
+                     }
+
+                     w.endObject();
+                     w.endDocument();
+                   });
+
+  AtomicFile file(out + ".delta");
+  file.write(buffer);
+  file.commit();
+}
+
+void LOOTWorker::writeDeltaMembers(ReportWriter& w, ReportContext& cx,
+                                   const DeltaState& previous,
+                                   const DeltaState& current) const
+{
+  std::unordered_map<std::string_view, std::string_view> before;
+  for (const auto& [name, entry] : previous.entries) {
+    before.emplace(name, entry);
+  }
+
+  std::vector<std::string_view> added, changed;
+  std::unordered_set<std::string_view> reported;
+
+  for (const auto& [name, entry] : current.entries) {
+    reported.insert(name);
+
+    const auto itor = before.find(name);
+    if (itor == before.end()) {
+      added.push_back(entry);
+    } else if (itor->second != entry) {
+      changed.push_back(entry);
+    }
+  }
+
+  using Strings = std::vector<std::string_view>;
+
+  auto writeEntries = [&](std::string_view key, const Strings& v) {
+    if (v.empty()) {
+      return;
+    }
+
+    w.key(key);
+    w.beginArray();
+
+    for (const auto entry : v) {
+      w.raw(entry);
+    }
+
+    w.endArray();
+  };
+
+  auto writeNames = [&](std::string_view key, const Strings& v) {
+    if (v.empty()) {
+      return;
+    }
+
+    w.key(key);
+    w.beginArray();
+
+    for (const auto name : v) {
+      w.value(name);
+    }
+
+    w.endArray();
+  };
+
+  writeEntries("addedPlugins", added);
+  writeEntries("changedPlugins", changed);
+
+  if (m_MessageTable) {
+    writeMessageTable(w, cx);
+  }
+
+  if (current.messages != previous.messages) {
+    // an empty array tells that there are no general messages anymore
+    if (!writeMessages(w, cx, cx.generalMessages)) {
+      w.key("messages");
+      w.beginArray();
+      w.endArray();
+    }
+  }
+
+  const auto moves = loadOrderMoves(previous.order, current.order);
+
+  if (!moves.empty()) {
+    w.key("moves");
+    w.beginArray();
+
+    for (const auto& m : moves) {
+      w.beginObject();
+      w.member("index", static_cast<std::int64_t>(m.index));
+      w.member("name", m.name);
+      w.endObject();
+    }
+
+    w.endArray();
+  }
+
+  const std::unordered_set<std::string_view> loaded(current.order.begin(),
+                                                    current.order.end());
+
+  std::vector<std::string_view> unloaded;
+  for (const auto& name : previous.order) {
+    if (!loaded.contains(name)) {
+      unloaded.push_back(name);
+    }
+  }
+
+  std::vector<std::string_view> removed;
+  for (const auto& [name, entry] : previous.entries) {
+    if (!reported.contains(name)) {
+      removed.push_back(name);
+    }
+  }
+
+  writeNames("removedFromLoadOrder", unloaded);
+  writeNames("removedPlugins", removed);
+}
+
+void LOOTWorker::writeMessageTable(ReportWriter& w, ReportContext& cx) const
+{
+  const auto table = cx.messages.table();
+
+  if (table.empty()) {
+    return;
+  }
+
+  w.key("messageTable");
+  w.beginArray();
+
+  for (auto* e : table) {
+    w.beginObject();
+    w.member("id", e->id);
+    w.member("text", e->text);
+    w.member("type", e->type);
+    w.endObject();
+  }
+
+  w.endArray();
+}
+
+void LOOTWorker::writeRoot(ReportWriter& w, std::string& buffer, AtomicFile& file,
+                           ReportContext& cx,
+                           const std::vector<std::string>& sortedPlugins) const
+{
+  // plugins are built concurrently a chunk at a time and each chunk is written
+  // in load order before the next one is built, so only a chunk is ever in
+  // memory and the report is the same regardless of the thread count
+  const std::size_t chunkSize = 256;
+
+  // the general messages don't depend on the plugins, they're evaluated while
+  // the first chunk is built
+  auto generalMessages = std::async(std::launch::async, [&] {
+    const auto span = m_Trace.span("GetGeneralMessages");
+    return cx.game.GetDatabase().GetGeneralMessages(true, true);
+  });
+
+  auto metadata = [&](const std::string& pluginName) {
+    const auto span = m_Trace.span("GetPluginMetadata", pluginName);
+    return cx.game.GetDatabase().GetPluginMetadata(pluginName, true, true);
+  };
+
+  bool hasPlugins = false;
+
+  auto writeEntry = [&](const std::string& name, const std::string& plugin) {
+    if (!hasPlugins) {
+      w.key("plugins");
+      w.beginArray();
+      hasPlugins = true;
+    }
+
+    w.raw(plugin);
+    ++cx.pluginsWritten;
+
+    if (cx.delta) {
+      cx.delta->entries.emplace_back(name, plugin);
+    }
+  };
+
+  // with a table, the table is the first member but is only complete once
+  // every message has been resolved, so the plugins are kept until the end;
+  // their messages are ids then, which keeps them small
+  std::vector<std::pair<std::size_t, std::string>> kept;
+
+  // members are in the order QJsonObject used to write them, sorted by key
+  w.beginDocument();
+  w.beginObject();
+
+  // the strings keep their capacity from one chunk to the next
+  std::vector<std::string> plugins(std::min(chunkSize, sortedPlugins.size()));
+  std::vector<std::optional<loot::PluginMetadata>> metadatas;
+
+  for (std::size_t begin = 0; begin < sortedPlugins.size(); begin += chunkSize) {
+    const auto count = std::min(chunkSize, sortedPlugins.size() - begin);
+
+    if (m_MessageTable) {
+      // messages get their id when they're first resolved, which only depends
+      // on that order when hashes collide, so the plugins are still built in
+      // load order on this thread; evaluating the metadata is what takes
+      // time, that's still done concurrently
+      metadatas.resize(count);
+
+      parallelFor(count, cx.job.threads, [&](std::size_t i) {
+        metadatas[i] = metadata(sortedPlugins[begin + i]);
+      });
+
+      for (std::size_t i = 0; i < count; ++i) {
+        createPlugin(cx, sortedPlugins[begin + i], metadatas[i], plugins[i]);
+        cx.job.meter.add(1, static_cast<std::int64_t>(plugins[i].size()));
+
+        if (!plugins[i].empty()) {
+          kept.emplace_back(begin + i, std::move(plugins[i]));
+        }
+      }
+
+      continue;
+    }
+
+    parallelFor(count, cx.job.threads, [&](std::size_t i) {
+      const auto& name = sortedPlugins[begin + i];
+      createPlugin(cx, name, metadata(name), plugins[i]);
+      cx.job.meter.add(1, static_cast<std::int64_t>(plugins[i].size()));
+    });
+
+    if (generalMessages.valid()) {
+      cx.generalMessages = generalMessages.get();
+      writeMessages(w, cx, cx.generalMessages);
+    }
+
+    for (std::size_t i = 0; i < count; ++i) {
+      if (!plugins[i].empty()) {
+        writeEntry(sortedPlugins[begin + i], plugins[i]);
+      }
+    }
+
+    file.write(buffer);
+    buffer.clear();
+  }
+
+  if (generalMessages.valid()) {
+    cx.generalMessages = generalMessages.get();
+  }
+
+  if (m_MessageTable) {
+    for (const auto& m : cx.generalMessages) {
+      cx.messages.resolve(m.GetType(), m.GetContent());
+    }
+
+    writeMessageTable(w, cx);
+    writeMessages(w, cx, cx.generalMessages);
+
+    for (std::size_t i = 0; i < kept.size(); ++i) {
+      writeEntry(sortedPlugins[kept[i].first], kept[i].second);
+
+      if ((i + 1) % chunkSize == 0) {
+        file.write(buffer);
+        buffer.clear();
+      }
+    }
+  } else if (sortedPlugins.empty()) {
+    writeMessages(w, cx, cx.generalMessages);
+  }
+
+  if (hasPlugins) {
+    w.endArray();
+  }
+
+  const auto end = std::chrono::high_resolution_clock::now();
+
+  m_Phases.count(Progress::ParsingLootMessages, "pluginsReported", cx.pluginsWritten);
+  m_Phases.count(Progress::ParsingLootMessages, "messagesReported",
+                 cx.messagesWritten);
+
+  w.key("stats");
+  w.beginObject();
+  if (cx.job.loadOrderChanged) {
+    w.member("loadOrderChanged", true);
+  }
+  w.member("lootVersion", loot::GetLiblootVersion());
+  w.member("lootcliVersion", LOOTCLI_VERSION_STRING);
+  writePhases(w, m_Phases.snapshot());
+  w.member("time", static_cast<std::int64_t>(
+                       std::chrono::duration_cast<std::chrono::milliseconds>(
+                           end - m_startTime)
+                           .count()));
+  w.endObject();
+
+  w.endObject();
+  w.endDocument();
+}
+
+void LOOTWorker::writePhases(ReportWriter& w,
+                             const std::vector<PhaseStats>& phases) const
+{
+  if (phases.empty()) {
+    return;
+  }
+
+  w.key("phases");
+  w.beginArray();
+
+  for (auto&& p : phases) {
+    w.beginObject();
+
+    if (!p.counters.empty()) {
+      w.key("counters");
+      w.beginObject();
+
+      for (auto&& [name, n] : p.counters) {
+        w.member(name, n);
+      }
+
+      w.endObject();
+    }
+
+    w.member("name", progressToString(p.phase));
+    w.member("peakRssBytes", p.peakRssBytes);
+    w.member("systemMicroseconds", p.systemMicroseconds);
+    w.member("userMicroseconds", p.userMicroseconds);
+    w.member("wallMicroseconds", p.wallMicroseconds);
+    w.endObject();
+  }
+
+  w.endArray();
+}
+
+void LOOTWorker::createPlugin(ReportContext& cx, const std::string& pluginName,
+                              const std::optional<loot::PluginMetadata>& metadata,
+                              std::string& out) const
+{
+  // scratch memory for building the plugin, anything that doesn't fit in the
+  // buffer comes from the heap and is all released when the plugin is done
+  std::array<std::byte, 4096> buffer;
+  std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size());
+
+  out.clear();
+
+  withReportWriter(m_ReportFormat, out, 2, &arena, [&](ReportWriter& w) {
+    // don't add if the name is the only thing in there
+    if (!writePlugin(w, cx, pluginName, metadata)) {
+      out.clear();
+    }
+  });
+}
+
+bool LOOTWorker::writePlugin(ReportWriter& w, ReportContext& cx,
+                             const std::string& pluginName,
+                             const std::optional<loot::PluginMetadata>& metadata) const
+{
+  const auto* plugin = cx.plugins.find(pluginName);
+  if (!plugin) {
+    return false;
+  }
+
+  bool written = false;
+
+  w.beginObject();
+
+  if (metadata) {
+    written |= writeClean(w, cx, metadata->GetCleanInfo());
+    written |= writeDirty(w, cx, metadata->GetDirtyInfo());
+    written |= writeIncompatibilities(w, cx, metadata->GetIncompatibilities());
+  }
+
+  if (plugin->IsLightPlugin()) {
+    w.member("isLightMaster", true);
+    written = true;
+  }
+
+  if (plugin->IsMaster()) {
+    w.member("isMaster", true);
+    written = true;
+  }
+
+  if (plugin->LoadsArchive()) {
+    w.member("loadsArchive", true);
+    written = true;
+  }
+
+  if (metadata) {
+    written |= writeMessages(w, cx, metadata->GetMessages());
+  }
+
+  written |= writeMissingMasters(w, cx, *plugin);
+
+  w.member("name", pluginName);
+  w.endObject();
+
+  return written;
+}
+
+bool LOOTWorker::writeMessages(ReportWriter& w, ReportContext& cx,
+                               const std::vector<loot::Message>& list) const
+{
+  bool empty = true;
+
+  for (const auto& m : list) {
+    const auto& e = cx.messages.resolve(m.GetType(), m.GetContent());
+    if (!e.found) {
+      continue;
+    }
+
+    if (empty) {
+      w.key("messages");
+      w.beginArray();
+      empty = false;
+    }
+
+    if (m_MessageTable) {
+      w.value(e.id);
+    } else {
+      w.beginObject();
+      w.member("text", e.text);
+      w.member("type", e.type);
+      w.endObject();
+    }
+
+    ++cx.messagesWritten;
+  }
+
+  if (empty) {
+    return false;
+  }
+
+  w.endArray();
+  return true;
+}
+
+bool LOOTWorker::writeDirty(ReportWriter& w, ReportContext& cx,
+                            const std::vector<loot::PluginCleaningData>& data) const
+{
+  if (data.empty()) {
+    return false;
+  }
+
+  w.key("dirty");
+  w.beginArray();
+
+  for (const auto& d : data) {
+    w.beginObject();
+
+    if (!d.GetCleaningUtility().empty()) {
+      w.member("cleaningUtility", d.GetCleaningUtility());
+    }
+
+    w.member("crc", static_cast<std::int64_t>(d.GetCRC()));
+    w.member("deletedNavmesh", static_cast<std::int64_t>(d.GetDeletedNavmeshCount()));
+    w.member("deletedReferences",
+             static_cast<std::int64_t>(d.GetDeletedReferenceCount()));
+
+    writeInfo(w, cx, d);
+
+    w.member("itm", static_cast<std::int64_t>(d.GetITMCount()));
+
+    w.endObject();
+  }
+
+  w.endArray();
+  return true;
+}
+
+bool LOOTWorker::writeClean(ReportWriter& w, ReportContext& cx,
+                            const std::vector<loot::PluginCleaningData>& data) const
+{
+  if (data.empty()) {
+    return false;
+  }
+
+  w.key("clean");
+  w.beginArray();
+
+  for (const auto& d : data) {
+    w.beginObject();
+
+    if (!d.GetCleaningUtility().empty()) {
+      w.member("cleaningUtility", d.GetCleaningUtility());
+    }
+
+    w.member("crc", static_cast<std::int64_t>(d.GetCRC()));
+
+    writeInfo(w, cx, d);
+
+    w.endObject();
+  }
+
+  w.endArray();
+  return true;
+}
+
+void LOOTWorker::writeInfo(ReportWriter& w, ReportContext& cx,
+                           const loot::PluginCleaningData& d) const
+{
+  const auto& e = cx.messages.resolve(loot::MessageType::say, d.GetDetail());
+  if (!e.found || e.text.empty()) {
+    return;
+  }
+
+  if (m_MessageTable) {
+    w.member("info", e.id);
+  } else {
+    w.member("info", e.text);
+  }
+}
+
+bool LOOTWorker::writeIncompatibilities(ReportWriter& w, ReportContext& cx,
+                                        const std::vector<loot::File>& data) const
+{
+  bool empty = true;
+
+  for (auto&& f : data) {
+    const auto name = static_cast<std::string>(f.GetName());
+    if (!cx.plugins.contains(name)) {
+      continue;
+    }
+
+    if (empty) {
+      w.key("incompatibilities");
+      w.beginArray();
+      empty = false;
+    }
+
+    w.beginObject();
+
+    const auto displayName = f.GetDisplayName();
+    if (displayName != name && !displayName.empty()) {
+      w.member("displayName", displayName);
+    }
+
+    w.member("name", name);
+    w.endObject();
+  }
+
+  if (empty) {
+    return false;
+  }
+
+  w.endArray();
+  return true;
+}
+
+bool LOOTWorker::writeMissingMasters(ReportWriter& w, ReportContext& cx,
+                                     const loot::PluginInterface& plugin) const
+{
+  bool empty = true;
+
+  for (auto&& master : plugin.GetMasters()) {
+    if (cx.plugins.contains(master)) {
+      continue;
+    }
+
+    if (empty) {
+      w.key("missingMasters");
+      w.beginArray();
+      empty = false;
+    }
+
+    w.value(master);
+  }
+
+  if (empty) {
+    return false;
+  }
+
+  w.endArray();
+  return true;
+}
 
 void LOOTWorker::progress(Progress p)
 {
-  std::cout << "[progress] " << static_cast<int>(p) << "\n";
-  std::cout.flush();
+  if (m_Phases.current()) {
+    m_Trace.end();
+  }
+
+  if (p == Progress::Done) {
+    m_Phases.stop();
+  } else {
+    m_Phases.start(p);
+    m_Trace.begin(progressToString(p));
+  }
+
+  // the log lines before it are flushed along with it
+  m_Output.pushAndFlush("[progress] " + std::to_string(static_cast<int>(p)) + "\n");
 }
 
 void LOOTWorker::log(loot::LogLevel level, const std::string_view message) const
@@ -972,11 +2621,19 @@ void LOOTWorker::log(loot::LogLevel level, const std::string_view message) const
     return;
   }
 
-  const auto ll        = fromLootLogLevel(level);
-  const auto levelName = logLevelToString(ll);
+  const auto levelName = logLevelToString(fromLootLogLevel(level));
 
-  std::cout << "[" << levelName << "] " << message << "\n";
-  std::cout.flush();
+  std::string line;
+  line.reserve(levelName.size() + message.size() + 4);
+  line += '[';
+  line += levelName;
+  line += "] ";
+  line += message;
+  line += '\n';
+
+  // libloot logs from its own threads and from the report's threads, the sink
+  // keeps their lines apart
+  m_Output.push(std::move(line));
 }
 
 loot::LogLevel toLootLogLevel(lootcli::LogLevels level)
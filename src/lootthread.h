@@ -1,11 +1,27 @@
 #ifndef LOOTTHREAD_H
 #define LOOTTHREAD_H
 
+#include "atomic_file.h"
+#include "batch_jobs.h"
+#include "delta.h"
+#include "download.h"
 #include "game_settings.h"
+#include "hash.h"
+#include "log_message.h"
+#include "log_sink.h"
+#include "message_cache.h"
+#include "phase_stats.h"
+#include "trace.h"
+#include "plugin_index.h"
+#include "progress_meter.h"
+#include "report_writer.h"
 #include "loot/database_interface.h"
-#include <QJsonArray>
 #include <loot/api.h>
 #include <lootcli/lootcli.h>
+#include <array>
+#include <atomic>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <toml++/toml.h>
 
@@ -20,6 +36,22 @@ namespace lootcli
 loot::LogLevel toLootLogLevel(lootcli::LogLevels level);
 lootcli::LogLevels fromLootLogLevel(loot::LogLevel level);
 
+// size and modification time of a file, used to detect whether a file has
+// changed since it was last loaded
+struct FileStamp
+{
+  std::uintmax_t size = 0;
+  std::filesystem::file_time_type time;
+
+  // always 0 on windows
+  std::uint64_t inode = 0;
+
+  bool operator==(const FileStamp&) const = default;
+};
+
+// returns nothing if the file doesn't exist or can't be read
+std::optional<FileStamp> getFileStamp(const std::filesystem::path& path);
+
 class LOOTWorker
 {
 public:
@@ -36,14 +68,96 @@ public:
 
   void setUpdateMasterlist(bool update);
 
+  // libloot can't re-place only the plugins that changed, every sort is a
+  // full SortPlugins(); what's skipped is that call alone when the game, the
+  // lists, both load order files and every plugin's file are the same as
+  // after the last sort, the load order is then that sort's result
+  //
+  // with verify, the full sort runs anyway and any difference from the kept
+  // load order is logged and the full sort's result used
+  //
+  void setVerifyIncremental(bool verify);
+
+  // number of threads that build the plugins in the report and that sort the
+  // load orders of a batch; 1 does everything on the calling thread and 0
+  // uses one thread per core
+  //
+  // plugins are always loaded by libloot, which uses its own threads
+  void setThreads(unsigned int threads);
+
+  void setReportFormat(ReportFormat format);
+
+  // writes each distinct message once in a table at the end of the report,
+  // plugins refer to them by index
+  void setMessageTable(bool table);
+
+  // also writes the differences from the last sort of the profile to the
+  // output file with ".delta" appended, see lootcli.h; ignored by runBatch()
+  void setDelta(bool delta);
+
+  // writes a chrome trace of each run to the given file, empty for none
+  void setTraceFile(const std::string& path);
+
+  // what happens to log lines when they come faster than stdout takes them,
+  // progress is never dropped
+  void setLogOverflow(LogOverflow overflow);
+
+  // folder used instead of LOOT's data folder for the settings, masterlists
+  // and userlists, empty for LOOT's
+  void setLootDataPath(const std::string& path);
+
   int run();
 
+  // sorts the profiles of all the jobs in one run: jobs with the same load
+  // order are sorted once, and distinct load orders are sorted concurrently
+  // on up to --threads game handles; each handle parses the lists and loads
+  // the plugins of its load orders once; the other options are the same for
+  // all the jobs
+  //
+  // libloot handles don't share loaded plugins, so a plugin in the load
+  // orders of several handles is read by each of them; more handles trade
+  // reading plugins for sorting and writing reports concurrently, see the
+  // "batch" bench case
+  //
+  // returns 1 if any job failed, the others are still sorted
+  //
+  int runBatch(const std::vector<BatchJob>& jobs);
+
+  // downloads the masterlists of all the games in LOOT's settings
+  // concurrently, so sorts can skip the download; returns 1 if any failed
+  //
+  int prefetchMasterlists();
+
+  // prints the fingerprint of the current inputs and whether the results of
+  // the last sort are still current
+  int checkFingerprint();
+
+  // timing of the phases of the last run
+  std::vector<PhaseStats> phases() const;
+
+  // where the output of the worker goes; lines written around its runs, such
+  // as the daemon's, must go through it too so they stay in order
+  LogSink& output();
+  const LogSink& output() const;
+
 private:
   void progress(Progress p);
   void log(loot::LogLevel level, const std::string_view message) const;
 
-  void GetFile(const std::string& url, const std::filesystem::path& fileName);
+  // whether messages of the level are logged, see LOOTCLI_LOG()
+  bool logEnabled(loot::LogLevel level) const { return level >= m_LogLevel; }
+
+  DownloadResult GetFile(const std::string& url, const std::filesystem::path& fileName);
+  DownloadSession& downloadSession();
   void getSettings(const std::filesystem::path& file);
+  std::vector<loot::GameSettings> getAllGameSettings(const std::filesystem::path& file);
+
+  // the type and folder of a [[games]] table, throws if it's invalid
+  loot::GameSettings newGameSettings(const toml::table& gameTable);
+
+  // the other settings of a [[games]] table
+  void readGameSettings(const toml::table& gameTable, loot::GameSettings& settings);
+
   std::string getOldDefaultRepoUrl(loot::GameId gameType);
   std::optional<std::string> GetLocalFolder(const toml::table& table);
   bool IsNehrim(const toml::table& table);
@@ -58,6 +172,7 @@ private:
                                                            std::string branch);
   std::string migrateMasterlistSource(const std::string& source);
 
+  std::filesystem::path lootDataPath() const;
   std::filesystem::path gamePath() const;
   std::filesystem::path masterlistPath() const;
   std::filesystem::path settingsPath() const;
@@ -66,6 +181,113 @@ private:
   std::filesystem::path dataPath() const;
 
 private:
+  // a game handle kept alive between runs along with the state of the files
+  // that were loaded into it
+  struct CachedGame
+  {
+    std::filesystem::path profile;
+    std::unique_ptr<loot::GameInterface> handle;
+    std::optional<FileStamp> masterlist;
+    std::optional<FileStamp> userlist;
+    std::uint64_t listsHash = 0;
+    std::map<std::string, std::optional<FileStamp>> plugins;
+
+    // content hash of the lists on disk and the stamps of the files it was
+    // computed from, the files are only read again when a stamp changes
+    std::optional<FileStamp> hashedMasterlist;
+    std::optional<FileStamp> hashedUserlist;
+    std::optional<std::uint64_t> hashedLists;
+  };
+
+  using Clock = std::chrono::steady_clock;
+
+  // durations of two phases that run concurrently and the wall time of both
+  struct PhaseOverlap
+  {
+    Clock::time_point start = Clock::now();
+    Clock::duration first{};
+    Clock::duration second{};
+    Clock::duration wall{};
+  };
+
+  void logOverlap(std::string_view first, std::string_view second,
+                  const PhaseOverlap& o) const;
+
+  // run() and runBatch() without writing the trace
+  int runSort();
+  int runBatchSort(const std::vector<BatchJob>& jobs);
+
+  // writes the trace, if any, and flushes the output
+  void finishRun();
+
+  // these report the phase and log what failed, the masterlist must exist
+  // unless it's about to be downloaded
+  bool checkMasterlist();
+  bool downloadMasterlist();
+
+  // loads the settings and the game handle of the current profile
+  CachedGame& prepare();
+  void prepareSettings();
+
+  CachedGame& cachedGame(const std::filesystem::path& profile);
+
+  // contents of the files of a profile that libloot reads the load order
+  // from, plugins.txt and loadorder.txt; empty for a file that doesn't exist
+  using LoadOrderFiles = std::array<std::optional<std::string>, 2>;
+
+  LoadOrderFiles readLoadOrderFiles(const std::filesystem::path& profile) const;
+
+  // gives the handle a load order by writing the files to the handle's
+  // profile folder
+  void useLoadOrderOf(CachedGame& game, const LoadOrderFiles& files);
+
+  // replaces the file only if its content would change, returns whether it
+  // did; throws if the file can't be written
+  bool writeLoadOrder(const std::string& path,
+                      const std::vector<std::string>& sortedPlugins) const;
+  std::uint64_t listsHash(CachedGame& game) const;
+  void dropRemovedUserlist(CachedGame& game);
+  void loadLists(CachedGame& game);
+
+  // the stamp of every plugin of a load order, empty for plugins that
+  // couldn't be stamped
+  using PluginStamps = std::map<std::string, std::optional<FileStamp>>;
+
+  PluginStamps pluginStamps(const std::vector<std::string>& loadOrder) const;
+  std::optional<FileStamp> pluginStamp(const std::string& pluginName) const;
+
+  // stamps must have every plugin of the load order
+  void loadPlugins(CachedGame& game, const std::vector<std::string>& loadOrder,
+                   const PluginStamps& stamps, ProgressMeter& meter);
+  void loadPluginFiles(loot::GameInterface& game,
+                       const std::vector<std::string>& plugins,
+                       const PluginStamps& stamps, ProgressMeter& meter) const;
+
+  struct Fingerprints
+  {
+    // hash over everything that affects the sorted order: the game, the
+    // lists, the profile's load order files and every plugin's file
+    std::string sort;
+
+    // also includes what only affects the report, such as the language
+    std::string run;
+  };
+
+  Fingerprints fingerprints(CachedGame& game, const std::vector<std::string>& loadOrder,
+                            const PluginStamps& stamps) const;
+
+  // folder with the results of the last sort of a profile, the current one
+  // by default
+  std::filesystem::path profileStatePath() const;
+  std::filesystem::path profileStatePath(const std::filesystem::path& profile) const;
+  std::string readFingerprint(const std::filesystem::path& file) const;
+  bool useCachedResults(const Fingerprints& current);
+  std::vector<std::string> sortPlugins(CachedGame& game,
+                                       const std::vector<std::string>& loadOrder,
+                                       const Fingerprints& current);
+  void saveCachedResults(CachedGame& game,
+                         const std::vector<std::string>& sortedPlugins);
+
   // void handleErr(unsigned int resultCode, const char *description);
   bool sort(loot::Game& game);
   // const char *lootErrorString(unsigned int errorCode);
@@ -81,25 +303,132 @@ private:
   std::string m_PluginListPath;
   loot::LogLevel m_LogLevel;
   bool m_UpdateMasterlist;
+  bool m_VerifyIncremental;
+  unsigned int m_Threads;
+  ReportFormat m_ReportFormat;
+  bool m_MessageTable;
   mutable std::recursive_mutex mutex_;
   loot::GameSettings m_GameSettings;
   std::chrono::high_resolution_clock::time_point m_startTime;
 
-  std::string createJsonReport(loot::GameInterface& game,
-                               const std::vector<std::string>& sortedPlugins) const;
+  // timing of the phases of the current run, written in the report's stats
+  mutable PhaseTimer m_Phases;
+
+  std::string m_TracePath;
+  mutable Tracer m_Trace;
+  std::string m_LootDataPath;
+  bool m_LocaleInitialised;
+
+  bool m_Delta;
+
+  // everything written to stdout goes through here; libloot may log while
+  // the game handles are destroyed, so this must be declared before them
+  mutable LogSink m_Output;
+
+  // game handles by game, game path and profile, reused by later runs of the
+  // same worker in daemon mode
+  std::map<std::string, CachedGame> m_Games;
+
+  // created on the first download and kept so later downloads reuse its
+  // connections and tls sessions
+  std::unique_ptr<DownloadSession> m_Downloads;
+
+  // what differs between reports written concurrently by a batch sort
+  struct ReportJob
+  {
+    std::string out;
+
+    // whether the run rewrote the load order file
+    bool loadOrderChanged = false;
+
+    // threads building the plugins
+    unsigned int threads = 1;
+
+    // shared by the reports of a run
+    ProgressMeter& meter;
+
+    // also writes the delta document and keeps what the next one needs
+    bool delta = false;
+  };
+
+  // what the functions writing a report share
+  struct ReportContext
+  {
+    loot::GameInterface& game;
+    const PluginIndex& plugins;
+    MessageCache& messages;
+    const ReportJob& job;
+
+    // written so far, for the stats
+    std::atomic<std::int64_t> pluginsWritten  = 0;
+    std::atomic<std::int64_t> messagesWritten = 0;
+
+    std::vector<loot::Message> generalMessages = {};
+
+    // gets the entries of the report when given
+    DeltaState* delta = nullptr;
+  };
+
+  // writes the report to the job's output file as the plugins are built
+  // instead of building the whole report first
+  //
+  void writeReport(loot::GameInterface& game,
+                   const std::vector<std::string>& sortedPlugins,
+                   const ReportJob& job) const;
+
+  // identifies how the entries of a delta state were written
+  std::string deltaTag() const;
+
+  // writes the delta document next to the report at out; current is null if
+  // nothing changed since the previous sort, and cx must then be null too
+  //
+  void writeDelta(const std::string& out, const std::optional<DeltaState>& previous,
+                  const DeltaState* current, ReportContext* cx) const;
+
+  void writeDeltaMembers(ReportWriter& w, ReportContext& cx,
+                         const DeltaState& previous, const DeltaState& current) const;
+
+  void writeMessageTable(ReportWriter& w, ReportContext& cx) const;
+
+  // writes the root object with w, which appends to buffer; buffer is written
+  // to the file after each chunk of plugins
+  //
+  void writeRoot(ReportWriter& w, std::string& buffer, AtomicFile& file,
+                 ReportContext& cx,
+                 const std::vector<std::string>& sortedPlugins) const;
+
+  // replaces out with a plugin for the plugins array of the report, out is
+  // left empty if there's nothing to report but its name
+  //
+  void createPlugin(ReportContext& cx, const std::string& pluginName,
+                    const std::optional<loot::PluginMetadata>& metadata,
+                    std::string& out) const;
+
+  // returns whether anything other than the name was written
+  //
+  bool writePlugin(ReportWriter& w, ReportContext& cx, const std::string& pluginName,
+                   const std::optional<loot::PluginMetadata>& metadata) const;
+
+  // these write their member of the current object unless it would be empty,
+  // and return whether they did
+  //
+  bool writeMessages(ReportWriter& w, ReportContext& cx,
+                     const std::vector<loot::Message>& list) const;
+  bool writeDirty(ReportWriter& w, ReportContext& cx,
+                  const std::vector<loot::PluginCleaningData>& data) const;
+  bool writeClean(ReportWriter& w, ReportContext& cx,
+                  const std::vector<loot::PluginCleaningData>& data) const;
 
-  QJsonArray createPlugins(loot::GameInterface& game,
-                           const std::vector<std::string>& sortedPlugins) const;
+  bool writeIncompatibilities(ReportWriter& w, ReportContext& cx,
+                              const std::vector<loot::File>& data) const;
 
-  QJsonValue createMessages(const std::vector<loot::Message>& list) const;
-  QJsonValue createDirty(const std::vector<loot::PluginCleaningData>& data) const;
-  QJsonValue createClean(const std::vector<loot::PluginCleaningData>& data) const;
+  bool writeMissingMasters(ReportWriter& w, ReportContext& cx,
+                           const loot::PluginInterface& plugin) const;
 
-  QJsonValue createIncompatibilities(loot::GameInterface& game,
-                                     const std::vector<loot::File>& data) const;
+  void writeInfo(ReportWriter& w, ReportContext& cx,
+                 const loot::PluginCleaningData& d) const;
 
-  QJsonValue createMissingMasters(loot::GameInterface& game,
-                                  const std::string& pluginName) const;
+  void writePhases(ReportWriter& w, const std::vector<PhaseStats>& phases) const;
 };
 
 }  // namespace lootcli
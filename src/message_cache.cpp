@@ -0,0 +1,106 @@
+#include "message_cache.h"
+#include "hash.h"
+
+namespace lootcli
+{
+
+MessageCache::MessageCache(std::string language)
+    : m_language(std::move(language))
+{}
+
+const MessageCache::Entry&
+MessageCache::resolve(loot::MessageType type,
+                      const std::vector<loot::MessageContent>& content)
+{
+  // identity of the message: its type and every text with its language,
+  // separated by characters that can't be in either
+  thread_local std::string key;
+
+  key.clear();
+  key += static_cast<char>('0' + static_cast<int>(type));
+
+  for (auto&& c : content) {
+    key += '\0';
+    key += c.GetLanguage();
+    key += '\0';
+    key += c.GetText();
+  }
+
+  {
+    std::shared_lock lock(m_mutex);
+
+    if (auto itor = m_entries.find(key); itor != m_entries.end()) {
+      return itor->second;
+    }
+  }
+
+  Entry e;
+  e.type = toString(type);
+
+  if (auto selected = loot::SelectMessageContent(content, m_language)) {
+    e.text  = selected->GetText();
+    e.found = true;
+  }
+
+  std::unique_lock lock(m_mutex);
+
+  // another thread may have resolved it in the meantime, its entry is kept
+  auto [itor, inserted] = m_entries.try_emplace(key, std::move(e));
+
+  if (inserted && itor->second.found) {
+    itor->second.id = newId(itor->second);
+    m_ids.emplace(itor->second.id, &itor->second);
+  }
+
+  return itor->second;
+}
+
+std::vector<const MessageCache::Entry*> MessageCache::table() const
+{
+  std::shared_lock lock(m_mutex);
+
+  std::vector<const Entry*> v;
+  v.reserve(m_ids.size());
+
+  for (auto&& [id, e] : m_ids) {
+    v.push_back(e);
+  }
+
+  return v;
+}
+
+std::int64_t MessageCache::newId(const Entry& e) const
+{
+  const std::int64_t mask = (std::int64_t(1) << 53) - 1;
+
+  auto id = static_cast<std::int64_t>(hashBytes(e.text, hashBytes(e.type))) & mask;
+
+  // messages that only differ in other languages are reported the same and
+  // share the id; a colliding hash takes the next free id, which depends on
+  // the order the messages are resolved in
+  for (;;) {
+    const auto itor = m_ids.find(id);
+    if (itor == m_ids.end() ||
+        (itor->second->type == e.type && itor->second->text == e.text)) {
+      return id;
+    }
+
+    id = (id + 1) & mask;
+  }
+}
+
+std::string_view toString(loot::MessageType type)
+{
+  switch (type) {
+  case loot::MessageType::say:
+    return "info";
+  case loot::MessageType::warn:
+    return "warn";
+  case loot::MessageType::error:
+    return "error";
+  default:
+    return "unknown";
+  }
+}
+
+}  // namespace lootcli
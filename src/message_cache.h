@@ -0,0 +1,69 @@
+#ifndef LOOTCLI_MESSAGE_CACHE_H
+#define LOOTCLI_MESSAGE_CACHE_H
+
+#include <loot/api.h>
+#include <cstdint>
+#include <map>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace lootcli
+{
+
+// the same messages appear on many plugins, this selects the content of each
+// distinct message for the language once and gives it an id derived from its
+// type and text, used by the message table of the report; the id of a
+// message doesn't depend on the other messages, so it stays the same from one
+// report to the next
+//
+// can be used by multiple threads
+//
+class MessageCache
+{
+public:
+  struct Entry
+  {
+    // "info", "warn" or "error"
+    std::string_view type;
+    std::string text;
+
+    // false if the message has no content for the language, it's then not
+    // reported at all
+    bool found = false;
+
+    // id in the message table, only for found messages; fits in the 53 bits
+    // a json reader can represent exactly
+    std::int64_t id = 0;
+  };
+
+  explicit MessageCache(std::string language);
+
+  const Entry& resolve(loot::MessageType type,
+                       const std::vector<loot::MessageContent>& content);
+
+  // found messages in the order of their id
+  //
+  std::vector<const Entry*> table() const;
+
+private:
+  std::string m_language;
+  mutable std::shared_mutex m_mutex;
+
+  // by type and content, nodes don't move so entries can be returned
+  std::unordered_map<std::string, Entry> m_entries;
+
+  // found entries by id
+  std::map<std::int64_t, const Entry*> m_ids;
+
+  // the id of the reported type and text
+  std::int64_t newId(const Entry& e) const;
+};
+
+std::string_view toString(loot::MessageType type);
+
+}  // namespace lootcli
+
+#endif  // LOOTCLI_MESSAGE_CACHE_H
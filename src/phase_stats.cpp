@@ -0,0 +1,155 @@
+#include "phase_stats.h"
+
+#ifdef LOOTCLI_COUNT_ALLOCATIONS
+#include "allocation_counter.h"
+#endif
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace lootcli
+{
+
+ResourceUsage ResourceUsage::current()
+{
+  ResourceUsage u;
+
+#ifdef _WIN32
+  // FILETIME is in 100ns
+  auto micro = [](const FILETIME& t) {
+    ULARGE_INTEGER i;
+    i.LowPart  = t.dwLowDateTime;
+    i.HighPart = t.dwHighDateTime;
+    return static_cast<std::int64_t>(i.QuadPart / 10);
+  };
+
+  FILETIME creation, exit, kernel, user;
+  if (GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+    u.userMicroseconds   = micro(user);
+    u.systemMicroseconds = micro(kernel);
+  }
+
+  PROCESS_MEMORY_COUNTERS memory = {};
+  if (K32GetProcessMemoryInfo(GetCurrentProcess(), &memory, sizeof(memory))) {
+    u.peakRssBytes = static_cast<std::int64_t>(memory.PeakWorkingSetSize);
+  }
+#else
+  rusage r = {};
+  if (getrusage(RUSAGE_SELF, &r) == 0) {
+    auto micro = [](const timeval& t) {
+      return static_cast<std::int64_t>(t.tv_sec) * 1000000 + t.tv_usec;
+    };
+
+    u.userMicroseconds   = micro(r.ru_utime);
+    u.systemMicroseconds = micro(r.ru_stime);
+
+#ifdef __APPLE__
+    u.peakRssBytes = static_cast<std::int64_t>(r.ru_maxrss);
+#else
+    // kilobytes on linux
+    u.peakRssBytes = static_cast<std::int64_t>(r.ru_maxrss) * 1024;
+#endif
+  }
+#endif
+
+  return u;
+}
+
+void PhaseTimer::reset()
+{
+  std::scoped_lock lock(m_mutex);
+
+  m_done.clear();
+  m_current.reset();
+  m_counters.clear();
+}
+
+void PhaseTimer::start(Progress phase)
+{
+  const auto usage = ResourceUsage::current();
+
+  std::scoped_lock lock(m_mutex);
+
+  if (m_current) {
+    m_done.push_back(measure(*m_current));
+  }
+
+  m_current          = phase;
+  m_start            = Clock::now();
+  m_startUsage       = usage;
+
+#ifdef LOOTCLI_COUNT_ALLOCATIONS
+  m_startAllocations = allocationCount();
+#endif
+}
+
+void PhaseTimer::stop()
+{
+  std::scoped_lock lock(m_mutex);
+
+  if (m_current) {
+    m_done.push_back(measure(*m_current));
+    m_current.reset();
+  }
+}
+
+std::optional<Progress> PhaseTimer::current() const
+{
+  std::scoped_lock lock(m_mutex);
+  return m_current;
+}
+
+void PhaseTimer::count(Progress phase, const std::string& name, std::int64_t n)
+{
+  std::scoped_lock lock(m_mutex);
+  m_counters[phase][name] += n;
+}
+
+std::vector<PhaseStats> PhaseTimer::snapshot() const
+{
+  std::scoped_lock lock(m_mutex);
+
+  auto v = m_done;
+
+  if (m_current) {
+    v.push_back(measure(*m_current));
+  }
+
+  // counters are only attached now, they may be counted after their phase
+  for (auto& s : v) {
+    if (auto itor = m_counters.find(s.phase); itor != m_counters.end()) {
+      for (const auto& [name, n] : itor->second) {
+        s.counters[name] += n;
+      }
+    }
+  }
+
+  return v;
+}
+
+PhaseStats PhaseTimer::measure(Progress phase) const
+{
+  using namespace std::chrono;
+
+  const auto usage = ResourceUsage::current();
+  const auto wall  = duration_cast<microseconds>(Clock::now() - m_start);
+
+  PhaseStats s;
+  s.phase              = phase;
+  s.wallMicroseconds   = wall.count();
+  s.userMicroseconds   = usage.userMicroseconds - m_startUsage.userMicroseconds;
+  s.systemMicroseconds = usage.systemMicroseconds - m_startUsage.systemMicroseconds;
+  s.peakRssBytes       = usage.peakRssBytes;
+
+#ifdef LOOTCLI_COUNT_ALLOCATIONS
+  s.counters["allocations"] = allocationCount() - m_startAllocations;
+#endif
+
+  return s;
+}
+
+}  // namespace lootcli
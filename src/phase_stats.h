@@ -0,0 +1,96 @@
+#ifndef LOOTCLI_PHASE_STATS_H
+#define LOOTCLI_PHASE_STATS_H
+
+#include <lootcli/lootcli.h>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace lootcli
+{
+
+// resources used by the process since it started
+//
+struct ResourceUsage
+{
+  std::int64_t userMicroseconds   = 0;
+  std::int64_t systemMicroseconds = 0;
+
+  // high-water mark of the resident set, 0 if unknown
+  std::int64_t peakRssBytes = 0;
+
+  static ResourceUsage current();
+};
+
+// what one phase of a run took
+//
+struct PhaseStats
+{
+  Progress phase                  = Progress::None;
+  std::int64_t wallMicroseconds   = 0;
+  std::int64_t userMicroseconds   = 0;
+  std::int64_t systemMicroseconds = 0;
+
+  // peak of the process at the end of the phase
+  std::int64_t peakRssBytes = 0;
+
+  // things counted during the phase, such as plugins or bytes, by name; has
+  // "allocations" when built with LOOTCLI_COUNT_ALLOCATIONS
+  std::map<std::string, std::int64_t> counters;
+};
+
+// times the phases of a run: a phase ends when the next one starts, so
+// start() is called wherever the progress is reported
+//
+// cpu time is for the whole process, including the threads working for the
+// phase; can be used by multiple threads
+//
+class PhaseTimer
+{
+public:
+  // forgets all phases
+  //
+  void reset();
+
+  // ends the current phase, if any, and starts the given one
+  //
+  void start(Progress phase);
+
+  // ends the current phase
+  //
+  void stop();
+
+  // the phase that's running, if any
+  //
+  std::optional<Progress> current() const;
+
+  // adds n to a counter of the given phase, which doesn't have to be the
+  // current one
+  //
+  void count(Progress phase, const std::string& name, std::int64_t n);
+
+  // phases in the order they started, the current one is measured up to now
+  //
+  std::vector<PhaseStats> snapshot() const;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  mutable std::mutex m_mutex;
+  std::vector<PhaseStats> m_done;
+  std::optional<Progress> m_current;
+  Clock::time_point m_start;
+  ResourceUsage m_startUsage;
+  std::int64_t m_startAllocations = 0;
+  std::map<Progress, std::map<std::string, std::int64_t>> m_counters;
+
+  PhaseStats measure(Progress phase) const;
+};
+
+}  // namespace lootcli
+
+#endif  // LOOTCLI_PHASE_STATS_H
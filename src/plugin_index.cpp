@@ -0,0 +1,139 @@
+#include "plugin_index.h"
+#include "hash.h"
+#include <boost/locale.hpp>
+#include <bit>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LOOTCLI_SSE2
+#endif
+
+namespace lootcli
+{
+
+// names up to this size are folded on the stack when looking them up
+constexpr std::size_t MAX_STACK_NAME = 256;
+
+// lowercases the ascii characters of s into out, which must be as large;
+// returns false as soon as a character isn't ascii, out is then incomplete
+//
+bool foldAscii(std::string_view s, char* out)
+{
+  std::size_t i = 0;
+
+#ifdef LOOTCLI_SSE2
+  // 16 characters at a time: non-ascii bytes have their high bit set, 'A' to
+  // 'Z' get 0x20 added
+  const auto beforeA = _mm_set1_epi8('A' - 1);
+  const auto afterZ  = _mm_set1_epi8('Z' + 1);
+  const auto caseBit = _mm_set1_epi8(0x20);
+
+  for (; i + 16 <= s.size(); i += 16) {
+    const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s.data() + i));
+
+    if (_mm_movemask_epi8(v) != 0) {
+      return false;
+    }
+
+    const auto upper =
+        _mm_and_si128(_mm_cmpgt_epi8(v, beforeA), _mm_cmplt_epi8(v, afterZ));
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                     _mm_add_epi8(v, _mm_and_si128(upper, caseBit)));
+  }
+#endif
+
+  for (; i < s.size(); ++i) {
+    const auto c = static_cast<unsigned char>(s[i]);
+
+    if (c >= 0x80) {
+      return false;
+    }
+
+    out[i] = static_cast<char>((c >= 'A' && c <= 'Z') ? c + 0x20 : c);
+  }
+
+  return true;
+}
+
+std::string foldCase(std::string_view s)
+{
+  std::string folded(s.size(), '\0');
+
+  if (foldAscii(s, folded.data())) {
+    return folded;
+  }
+
+  return boost::locale::fold_case(std::string(s));
+}
+
+PluginIndex::PluginIndex(const std::vector<Plugin>& plugins)
+{
+  // at most half full, so probe sequences stay short
+  const auto size = std::bit_ceil(std::max<std::size_t>(plugins.size() * 2, 16));
+
+  m_slots.resize(size);
+  m_mask = size - 1;
+
+  for (auto&& p : plugins) {
+    if (p) {
+      insert(p);
+    }
+  }
+}
+
+void PluginIndex::insert(Plugin plugin)
+{
+  auto key        = foldCase(plugin->GetName());
+  const auto hash = hashBytes(key);
+
+  for (auto i = hash & m_mask;; i = (i + 1) & m_mask) {
+    auto& slot = m_slots[i];
+
+    if (!slot.plugin) {
+      slot.hash   = hash;
+      slot.key    = std::move(key);
+      slot.plugin = std::move(plugin);
+      return;
+    }
+
+    if (slot.hash == hash && slot.key == key) {
+      // loaded twice, the first one wins like with libloot
+      return;
+    }
+  }
+}
+
+const loot::PluginInterface* PluginIndex::find(std::string_view name) const
+{
+  // most names are short and ascii, they're folded on the stack
+  if (name.size() <= MAX_STACK_NAME) {
+    char buffer[MAX_STACK_NAME];
+
+    if (foldAscii(name, buffer)) {
+      const std::string_view folded(buffer, name.size());
+      return find(folded, hashBytes(folded));
+    }
+  }
+
+  const auto folded = foldCase(name);
+  return find(folded, hashBytes(folded));
+}
+
+const loot::PluginInterface* PluginIndex::find(std::string_view folded,
+                                               std::uint64_t hash) const
+{
+  for (auto i = hash & m_mask;; i = (i + 1) & m_mask) {
+    const auto& slot = m_slots[i];
+
+    if (!slot.plugin) {
+      return nullptr;
+    }
+
+    if (slot.hash == hash && slot.key == folded) {
+      return slot.plugin.get();
+    }
+  }
+}
+
+}  // namespace lootcli
@@ -0,0 +1,56 @@
+#ifndef LOOTCLI_PLUGIN_INDEX_H
+#define LOOTCLI_PLUGIN_INDEX_H
+
+#include <loot/api.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lootcli
+{
+
+// lowercases ascii names without allocating more than the result, names with
+// other characters are case-folded with the global locale
+//
+std::string foldCase(std::string_view s);
+
+// case-insensitive index of the plugins loaded by a game, built once so the
+// report doesn't go through libloot for every master and incompatibility it
+// looks up
+//
+// it's an open-addressing table with linear probing over the case-folded
+// names, read-only once built so it can be shared by threads
+//
+class PluginIndex
+{
+public:
+  using Plugin = std::shared_ptr<const loot::PluginInterface>;
+
+  explicit PluginIndex(const std::vector<Plugin>& plugins);
+
+  // the plugin with the given name, regardless of case, or null
+  //
+  const loot::PluginInterface* find(std::string_view name) const;
+
+  bool contains(std::string_view name) const { return find(name) != nullptr; }
+
+private:
+  struct Slot
+  {
+    std::uint64_t hash = 0;
+    std::string key;
+    Plugin plugin;
+  };
+
+  std::vector<Slot> m_slots;
+  std::size_t m_mask;
+
+  void insert(Plugin plugin);
+  const loot::PluginInterface* find(std::string_view folded, std::uint64_t hash) const;
+};
+
+}  // namespace lootcli
+
+#endif  // LOOTCLI_PLUGIN_INDEX_H
@@ -0,0 +1,71 @@
+#include "progress_meter.h"
+
+namespace lootcli
+{
+
+ProgressMeter::ProgressMeter(LogSink& out, Progress phase, std::int64_t total,
+                             std::chrono::milliseconds interval)
+    : m_out(out), m_phase(phase), m_interval(interval), m_start(Clock::now()),
+      m_total(total), m_done(0), m_bytes(0), m_last(m_start - interval)
+{}
+
+void ProgressMeter::add(std::int64_t items, std::int64_t bytes)
+{
+  ItemProgress p;
+
+  {
+    std::lock_guard lock(m_mutex);
+
+    m_done += items;
+    m_bytes += bytes;
+
+    const auto now  = Clock::now();
+    const bool last = (m_done >= m_total);
+
+    if (!last && now - m_last < m_interval) {
+      return;
+    }
+
+    m_last = now;
+    p      = current(now);
+  }
+
+  write(p);
+}
+
+void ProgressMeter::addTotal(std::int64_t items)
+{
+  std::lock_guard lock(m_mutex);
+  m_total += items;
+}
+
+ItemProgress ProgressMeter::current(Clock::time_point now) const
+{
+  ItemProgress p;
+
+  p.done  = m_done;
+  p.total = m_total;
+  p.bytes = m_bytes;
+
+  if (m_done > 0) {
+    using std::chrono::milliseconds;
+    const auto elapsed =
+        std::chrono::duration_cast<milliseconds>(now - m_start).count();
+    const auto left = std::max<std::int64_t>(0, m_total - m_done);
+
+    p.etaMilliseconds = left * elapsed / m_done;
+  }
+
+  return p;
+}
+
+void ProgressMeter::write(const ItemProgress& p)
+{
+  // flushed so the consumer sees it while the phase is still running
+  m_out.pushAndFlush("[progress] " + std::to_string(static_cast<int>(m_phase)) + " " +
+                     std::to_string(p.done) + "/" + std::to_string(p.total) + " " +
+                     std::to_string(p.bytes) + " " +
+                     std::to_string(p.etaMilliseconds) + "\n");
+}
+
+}  // namespace lootcli
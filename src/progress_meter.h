@@ -0,0 +1,59 @@
+#ifndef LOOTCLI_PROGRESS_METER_H
+#define LOOTCLI_PROGRESS_METER_H
+
+#include "log_sink.h"
+#include <lootcli/lootcli.h>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace lootcli
+{
+
+// reports the progress of a phase through a known number of items as
+// "[progress] <phase> <done>/<total> <bytes> <etaMilliseconds>" lines, see
+// Message
+//
+// a line is written as soon as the first items are done, then at most every
+// interval and always once the last item is done; the eta assumes the
+// remaining items take as long as the ones so far; can be used by multiple
+// threads
+//
+class ProgressMeter
+{
+public:
+  ProgressMeter(LogSink& out, Progress phase, std::int64_t total,
+                std::chrono::milliseconds interval = std::chrono::milliseconds(100));
+
+  // adds to the items and bytes that are done
+  //
+  void add(std::int64_t items, std::int64_t bytes);
+
+  // adds to the number of items, for meters created before all of them are
+  // known, such as one shared by several tasks
+  //
+  void addTotal(std::int64_t items);
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  LogSink& m_out;
+  const Progress m_phase;
+  const Clock::duration m_interval;
+  const Clock::time_point m_start;
+
+  std::mutex m_mutex;
+  std::int64_t m_total;
+  std::int64_t m_done;
+  std::int64_t m_bytes;
+  Clock::time_point m_last;
+
+  // the progress so far, the lock must be held
+  ItemProgress current(Clock::time_point now) const;
+
+  void write(const ItemProgress& p);
+};
+
+}  // namespace lootcli
+
+#endif  // LOOTCLI_PROGRESS_METER_H
@@ -0,0 +1,58 @@
+#ifndef LOOTCLI_REPORT_WRITER_H
+#define LOOTCLI_REPORT_WRITER_H
+
+#include <cstdint>
+#include <string_view>
+
+namespace lootcli
+{
+
+// appends a report to a string as it's written, without building a document
+// first; the structure is the same regardless of the format, see the schema
+// in lootcli.h
+//
+// members are written in the order they're given, the caller is responsible
+// for the order and for not repeating keys
+//
+class ReportWriter
+{
+public:
+  virtual ~ReportWriter() = default;
+
+  // called once before and after the root value of a document, not for
+  // values that are written separately and pasted with raw()
+  //
+  virtual void beginDocument() {}
+  virtual void endDocument() {}
+
+  virtual void beginObject() = 0;
+  virtual void endObject()   = 0;
+
+  virtual void beginArray() = 0;
+  virtual void endArray()   = 0;
+
+  // starts a member of the current object, must be followed by a value
+  //
+  virtual void key(std::string_view name) = 0;
+
+  virtual void value(std::string_view s) = 0;
+  virtual void value(std::int64_t i)     = 0;
+  virtual void value(bool b)             = 0;
+
+  void value(const char* s) { value(std::string_view(s)); }
+
+  // pastes a value written separately by a writer of the same format
+  //
+  virtual void raw(std::string_view data) = 0;
+
+  template <class T>
+  void member(std::string_view name, const T& v)
+  {
+    key(name);
+    value(v);
+  }
+};
+
+}  // namespace lootcli
+
+#endif  // LOOTCLI_REPORT_WRITER_H
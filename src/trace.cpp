@@ -0,0 +1,143 @@
+#include "trace.h"
+#include "atomic_file.h"
+#include "json_writer.h"
+
+namespace lootcli
+{
+
+Tracer::Span::Span(Tracer* tracer, std::string_view name, std::string_view detail)
+    : m_tracer(tracer), m_start(0)
+{
+  if (m_tracer) {
+    m_name   = name;
+    m_detail = detail;
+    m_start  = m_tracer->now();
+  }
+}
+
+Tracer::Span::~Span()
+{
+  if (m_tracer) {
+    const auto end = m_tracer->now();
+    m_tracer->add({'X', std::move(m_name), std::move(m_detail), m_start,
+                   end - m_start, threadId()});
+  }
+}
+
+Tracer::Tracer() : m_enabled(false), m_start(Clock::now())
+{}
+
+void Tracer::reset(bool enabled)
+{
+  std::scoped_lock lock(m_mutex);
+
+  m_events.clear();
+  m_start   = Clock::now();
+  m_enabled = enabled;
+}
+
+bool Tracer::enabled() const
+{
+  return m_enabled;
+}
+
+Tracer::Span Tracer::span(std::string_view name, std::string_view detail)
+{
+  return Span(enabled() ? this : nullptr, name, detail);
+}
+
+void Tracer::begin(std::string_view name)
+{
+  if (enabled()) {
+    add({'B', std::string(name), {}, now(), 0, threadId()});
+  }
+}
+
+void Tracer::end()
+{
+  if (enabled()) {
+    add({'E', {}, {}, now(), 0, threadId()});
+  }
+}
+
+void Tracer::instant(std::string_view name, std::string_view detail)
+{
+  if (enabled()) {
+    add({'i', std::string(name), std::string(detail), now(), 0, threadId()});
+  }
+}
+
+void Tracer::write(const std::filesystem::path& file) const
+{
+  std::string out;
+  JsonWriter w(out, 0, true);
+
+  {
+    std::scoped_lock lock(m_mutex);
+
+    w.beginDocument();
+    w.beginObject();
+    w.member("displayTimeUnit", "ms");
+    w.key("traceEvents");
+    w.beginArray();
+
+    for (auto&& e : m_events) {
+      w.beginObject();
+      w.member("ph", std::string_view(&e.phase, 1));
+      w.member("pid", std::int64_t(1));
+      w.member("tid", std::int64_t(e.thread));
+      w.member("ts", e.timestamp);
+
+      if (e.phase == 'X') {
+        w.member("dur", e.duration);
+      } else if (e.phase == 'i') {
+        // scoped to the thread
+        w.member("s", "t");
+      }
+
+      if (!e.name.empty()) {
+        w.member("name", e.name);
+        w.member("cat", "lootcli");
+      }
+
+      if (!e.detail.empty()) {
+        w.key("args");
+        w.beginObject();
+        w.member("detail", e.detail);
+        w.endObject();
+      }
+
+      w.endObject();
+    }
+
+    w.endArray();
+    w.endObject();
+    w.endDocument();
+  }
+
+  AtomicFile f(file);
+  f.write(out);
+  f.commit();
+}
+
+std::int64_t Tracer::now() const
+{
+  using namespace std::chrono;
+  return duration_cast<microseconds>(Clock::now() - m_start).count();
+}
+
+void Tracer::add(Event e)
+{
+  std::scoped_lock lock(m_mutex);
+  m_events.push_back(std::move(e));
+}
+
+int Tracer::threadId()
+{
+  static std::atomic<int> next = 1;
+  thread_local const int id    = next++;
+
+  return id;
+}
+
+}  // namespace lootcli
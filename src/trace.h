@@ -0,0 +1,98 @@
+#ifndef LOOTCLI_TRACE_H
+#define LOOTCLI_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lootcli
+{
+
+// records what the threads of a run are doing and writes it as chrome trace
+// event json, which can be opened in chrome://tracing or perfetto
+//
+// a disabled tracer records nothing and its spans cost a branch; can be used
+// by multiple threads
+//
+class Tracer
+{
+public:
+  // records a complete event for its lifetime on the thread that created it
+  //
+  class Span
+  {
+  public:
+    Span(Tracer* tracer, std::string_view name, std::string_view detail);
+    ~Span();
+
+    Span(const Span&)            = delete;
+    Span& operator=(const Span&) = delete;
+
+  private:
+    Tracer* m_tracer;
+    std::string m_name;
+    std::string m_detail;
+    std::int64_t m_start;
+  };
+
+  Tracer();
+
+  // forgets all events and starts recording if enabled
+  //
+  void reset(bool enabled);
+
+  bool enabled() const;
+
+  // detail is shown in the arguments of the event, if not empty
+  //
+  Span span(std::string_view name, std::string_view detail = {});
+
+  // begins or ends a span on the calling thread that doesn't follow a scope,
+  // such as a phase; end() closes the last span that was begun on the thread
+  //
+  void begin(std::string_view name);
+  void end();
+
+  // an event without duration, such as a log line
+  //
+  void instant(std::string_view name, std::string_view detail = {});
+
+  // writes the events recorded so far
+  //
+  void write(const std::filesystem::path& file) const;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Event
+  {
+    char phase;
+    std::string name;
+    std::string detail;
+    std::int64_t timestamp;
+    std::int64_t duration;
+    int thread;
+  };
+
+  std::atomic<bool> m_enabled;
+  Clock::time_point m_start;
+  mutable std::mutex m_mutex;
+  std::vector<Event> m_events;
+
+  // microseconds since reset()
+  std::int64_t now() const;
+
+  void add(Event e);
+
+  // small sequential ids, easier to read than the system's
+  static int threadId();
+};
+
+}  // namespace lootcli
+
+#endif  // LOOTCLI_TRACE_H
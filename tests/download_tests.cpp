@@ -0,0 +1,320 @@
+#include "download.h"
+#include "http_server.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+
+namespace fs = std::filesystem;
+
+namespace lootcli::tests
+{
+
+using Response = HttpServer::Response;
+
+const std::string LAST_MODIFIED = "Wed, 21 Oct 2015 07:28:00 GMT";
+
+std::int64_t now()
+{
+  return std::chrono::duration_cast<std::chrono::seconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+std::string readFile(const fs::path& path)
+{
+  std::ifstream in(path, std::ios::binary);
+  return {std::istreambuf_iterator<char>(in), {}};
+}
+
+class DownloadTest : public testing::Test
+{
+protected:
+  fs::path m_dir;
+
+  void SetUp() override
+  {
+    const auto* test = testing::UnitTest::GetInstance()->current_test_info();
+
+    m_dir = fs::temp_directory_path() / "lootcli_tests" / test->name();
+    fs::remove_all(m_dir);
+    fs::create_directories(m_dir);
+  }
+
+  void TearDown() override
+  {
+    std::error_code ec;
+    fs::remove_all(m_dir, ec);
+  }
+
+  fs::path file() const { return m_dir / "masterlist.yaml"; }
+};
+
+TEST_F(DownloadTest, DownloadsAndKeepsTheValidators)
+{
+  HttpServer server([](auto&&) {
+    return Response{200, {{"ETag", "\"v1\""}, {"Last-Modified", LAST_MODIFIED}}, "a"};
+  });
+
+  DownloadSession session;
+  const auto url = server.url("/masterlist.yaml");
+
+  EXPECT_EQ(session.download(url, file()), DownloadResult::Updated);
+  EXPECT_EQ(readFile(file()), "a");
+
+  const auto v = CacheValidators::load(file());
+  EXPECT_EQ(v.url, url);
+  EXPECT_EQ(v.etag, "\"v1\"");
+  EXPECT_EQ(v.lastModified, LAST_MODIFIED);
+  EXPECT_EQ(v.expires, 0);
+}
+
+TEST_F(DownloadTest, RevalidatesWithTheETag)
+{
+  HttpServer server([](const HttpServer::Request& r) {
+    if (r.header("if-none-match") == "\"v1\"") {
+      return Response{304, {{"ETag", "\"v1\""}}, ""};
+    }
+
+    return Response{200, {{"ETag", "\"v1\""}}, "a"};
+  });
+
+  DownloadSession session;
+  const auto url = server.url("/masterlist.yaml");
+
+  ASSERT_EQ(session.download(url, file()), DownloadResult::Updated);
+  EXPECT_EQ(session.download(url, file()), DownloadResult::NotModified);
+
+  const auto requests = server.requests();
+  ASSERT_EQ(requests.size(), 2);
+  EXPECT_EQ(requests[0].header("if-none-match"), "");
+  EXPECT_EQ(requests[1].header("if-none-match"), "\"v1\"");
+
+  EXPECT_EQ(readFile(file()), "a");
+  EXPECT_EQ(CacheValidators::load(file()).etag, "\"v1\"");
+}
+
+TEST_F(DownloadTest, RevalidatesWithLastModified)
+{
+  HttpServer server([](const HttpServer::Request& r) {
+    // a 304 without validators keeps the old ones
+    if (r.header("if-modified-since") == LAST_MODIFIED) {
+      return Response{304, {}, ""};
+    }
+
+    return Response{200, {{"Last-Modified", LAST_MODIFIED}}, "a"};
+  });
+
+  DownloadSession session;
+  const auto url = server.url("/masterlist.yaml");
+
+  ASSERT_EQ(session.download(url, file()), DownloadResult::Updated);
+  EXPECT_EQ(session.download(url, file()), DownloadResult::NotModified);
+
+  const auto requests = server.requests();
+  ASSERT_EQ(requests.size(), 2);
+  EXPECT_EQ(requests[1].header("if-modified-since"), LAST_MODIFIED);
+
+  EXPECT_EQ(readFile(file()), "a");
+  EXPECT_EQ(CacheValidators::load(file()).lastModified, LAST_MODIFIED);
+}
+
+TEST_F(DownloadTest, KeepsTheFileWhenTheContentIsUnchanged)
+{
+  HttpServer server([](auto&&) {
+    return Response{200, {}, "a"};
+  });
+
+  DownloadSession session;
+  const auto url = server.url("/masterlist.yaml");
+
+  ASSERT_EQ(session.download(url, file()), DownloadResult::Updated);
+  const auto time = fs::last_write_time(file());
+
+  EXPECT_EQ(session.download(url, file()), DownloadResult::Unchanged);
+  EXPECT_EQ(fs::last_write_time(file()), time);
+  EXPECT_EQ(readFile(file()), "a");
+  EXPECT_EQ(server.requests().size(), 2);
+}
+
+TEST_F(DownloadTest, ReplacesTheFileWhenTheContentChanged)
+{
+  int version = 0;
+
+  HttpServer server([&](auto&&) {
+    return Response{200, {}, ++version == 1 ? "a" : "b"};
+  });
+
+  DownloadSession session;
+  const auto url = server.url("/masterlist.yaml");
+
+  ASSERT_EQ(session.download(url, file()), DownloadResult::Updated);
+  EXPECT_EQ(session.download(url, file()), DownloadResult::Updated);
+  EXPECT_EQ(readFile(file()), "b");
+}
+
+TEST_F(DownloadTest, IsFreshForMaxAgeMinusAge)
+{
+  HttpServer server([](auto&&) {
+    return Response{200, {{"Cache-Control", "public, max-age=3600"}, {"Age", "600"}},
+                    "a"};
+  });
+
+  DownloadSession session;
+  const auto url = server.url("/masterlist.yaml");
+
+  const auto before = now();
+  ASSERT_EQ(session.download(url, file()), DownloadResult::Updated);
+  const auto after = now();
+
+  const auto expires = CacheValidators::load(file()).expires;
+  EXPECT_GE(expires, before + 3000);
+  EXPECT_LE(expires, after + 3000);
+
+  // no request is sent while the file is fresh
+  EXPECT_EQ(session.download(url, file()), DownloadResult::Fresh);
+  EXPECT_EQ(server.requests().size(), 1);
+}
+
+TEST_F(DownloadTest, IsNotFreshOnceAgeReachesMaxAge)
+{
+  HttpServer server([](auto&&) {
+    return Response{200, {{"Cache-Control", "max-age=600"}, {"Age", "600"}}, "a"};
+  });
+
+  DownloadSession session;
+  const auto url = server.url("/masterlist.yaml");
+
+  ASSERT_EQ(session.download(url, file()), DownloadResult::Updated);
+  EXPECT_EQ(CacheValidators::load(file()).expires, 0);
+
+  EXPECT_EQ(session.download(url, file()), DownloadResult::Unchanged);
+  EXPECT_EQ(server.requests().size(), 2);
+}
+
+TEST_F(DownloadTest, IsNeverFreshWithNoCache)
+{
+  HttpServer server([](auto&&) {
+    return Response{200, {{"Cache-Control", "max-age=3600, no-cache"}}, "a"};
+  });
+
+  DownloadSession session;
+  const auto url = server.url("/masterlist.yaml");
+
+  ASSERT_EQ(session.download(url, file()), DownloadResult::Updated);
+  EXPECT_EQ(CacheValidators::load(file()).expires, 0);
+}
+
+TEST_F(DownloadTest, FailedDownloadKeepsTheFile)
+{
+  bool fail = false;
+
+  HttpServer server([&](auto&&) {
+    if (fail) {
+      return Response{500, {}, "error"};
+    }
+
+    return Response{200, {{"ETag", "\"v1\""}}, "a"};
+  });
+
+  DownloadSession session;
+  const auto url = server.url("/masterlist.yaml");
+
+  ASSERT_EQ(session.download(url, file()), DownloadResult::Updated);
+
+  fail = true;
+  EXPECT_THROW(session.download(url, file()), std::runtime_error);
+
+  EXPECT_EQ(readFile(file()), "a");
+  EXPECT_EQ(CacheValidators::load(file()).etag, "\"v1\"");
+  EXPECT_FALSE(fs::exists(fs::path(file()).concat(".download")));
+}
+
+TEST_F(DownloadTest, UnreachableServerKeepsTheFile)
+{
+  std::string url;
+
+  {
+    HttpServer server([](auto&&) {
+      return Response{200, {}, "a"};
+    });
+
+    url = server.url("/masterlist.yaml");
+
+    DownloadSession session;
+    ASSERT_EQ(session.download(url, file()), DownloadResult::Updated);
+  }
+
+  DownloadSession session;
+  EXPECT_THROW(session.download(url, file()), std::runtime_error);
+  EXPECT_EQ(readFile(file()), "a");
+}
+
+// the new file must not be left with the validators of the old one when the
+// new validators can't be saved
+//
+TEST_F(DownloadTest, NewFileDoesntKeepTheOldValidators)
+{
+  std::atomic<int> version = 1;
+
+  HttpServer server([&](const HttpServer::Request& r) {
+    const auto v    = std::to_string(version);
+    const auto etag = "\"v" + v + "\"";
+
+    if (r.header("if-none-match") == etag) {
+      return Response{304, {}, ""};
+    }
+
+    return Response{200, {{"ETag", etag}}, v};
+  });
+
+  DownloadSession session;
+  const auto url = server.url("/masterlist.yaml");
+
+  ASSERT_EQ(session.download(url, file()), DownloadResult::Updated);
+  ASSERT_EQ(CacheValidators::load(file()).etag, "\"v1\"");
+
+  // a folder with a file in it where the sidecar is written first
+  const auto blocked = fs::path(CacheValidators::sidecarPath(file())).concat(".tmp");
+  fs::create_directories(blocked);
+  std::ofstream(blocked / "file") << "x";
+
+  version = 2;
+
+  DownloadStats stats;
+  EXPECT_EQ(session.download(url, file(), &stats), DownloadResult::Updated);
+  EXPECT_NE(stats.validatorsError, "");
+
+  EXPECT_EQ(readFile(file()), "2");
+  EXPECT_FALSE(fs::exists(CacheValidators::sidecarPath(file())));
+}
+
+TEST_F(DownloadTest, DownloadAllReportsEachOutcome)
+{
+  HttpServer server([](const HttpServer::Request& r) {
+    if (r.path == "/missing.yaml") {
+      return Response{404, {}, ""};
+    }
+
+    return Response{200, {}, "a"};
+  });
+
+  DownloadSession session;
+
+  const auto outcomes =
+      session.downloadAll({{server.url("/masterlist.yaml"), m_dir / "a.yaml"},
+                           {server.url("/missing.yaml"), m_dir / "b.yaml"}});
+
+  ASSERT_EQ(outcomes.size(), 2);
+
+  ASSERT_TRUE(outcomes[0].result);
+  EXPECT_EQ(*outcomes[0].result, DownloadResult::Updated);
+  EXPECT_EQ(readFile(m_dir / "a.yaml"), "a");
+
+  EXPECT_FALSE(outcomes[1].result);
+  EXPECT_NE(outcomes[1].error, "");
+  EXPECT_FALSE(fs::exists(m_dir / "b.yaml"));
+}
+
+}  // namespace lootcli::tests
@@ -0,0 +1,235 @@
+#include "http_server.h"
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace lootcli::tests
+{
+
+#ifdef _WIN32
+using Socket               = SOCKET;
+constexpr Socket NO_SOCKET = INVALID_SOCKET;
+constexpr int SEND_FLAGS   = 0;
+void closeSocket(Socket s)
+{
+  closesocket(s);
+}
+#else
+using Socket               = int;
+constexpr Socket NO_SOCKET = -1;
+constexpr int SEND_FLAGS   = MSG_NOSIGNAL;
+void closeSocket(Socket s)
+{
+  close(s);
+}
+#endif
+
+Socket toSocket(std::intptr_t s)
+{
+  return static_cast<Socket>(s);
+}
+
+std::string reasonPhrase(int status)
+{
+  switch (status) {
+  case 200:
+    return "OK";
+  case 304:
+    return "Not Modified";
+  case 404:
+    return "Not Found";
+  case 500:
+    return "Internal Server Error";
+  default:
+    return "Status";
+  }
+}
+
+std::string HttpServer::Request::header(const std::string& name) const
+{
+  const auto itor = headers.find(name);
+  return itor == headers.end() ? std::string() : itor->second;
+}
+
+HttpServer::HttpServer(Handler handler)
+    : m_handler(std::move(handler)), m_socket(0), m_port(0), m_stop(false)
+{
+#ifdef _WIN32
+  WSADATA data;
+  if (WSAStartup(MAKEWORD(2, 2), &data) != 0) {
+    throw std::runtime_error("WSAStartup failed");
+  }
+#endif
+
+  const Socket s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (s == NO_SOCKET) {
+    throw std::runtime_error("failed to create a socket");
+  }
+
+  sockaddr_in address{};
+  address.sin_family      = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port        = 0;
+
+  socklen_t size = sizeof(address);
+
+  if (bind(s, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+      listen(s, 16) != 0 ||
+      getsockname(s, reinterpret_cast<sockaddr*>(&address), &size) != 0) {
+    closeSocket(s);
+    throw std::runtime_error("failed to listen on a loopback port");
+  }
+
+  m_socket = static_cast<std::intptr_t>(s);
+  m_port   = ntohs(address.sin_port);
+  m_thread = std::thread([this] {
+    serve();
+  });
+}
+
+HttpServer::~HttpServer()
+{
+  m_stop = true;
+  m_thread.join();
+
+  closeSocket(toSocket(m_socket));
+
+#ifdef _WIN32
+  WSACleanup();
+#endif
+}
+
+std::string HttpServer::url(std::string_view path) const
+{
+  return "http://127.0.0.1:" + std::to_string(m_port) + std::string(path);
+}
+
+std::vector<HttpServer::Request> HttpServer::requests() const
+{
+  std::scoped_lock lock(m_mutex);
+  return m_requests;
+}
+
+void HttpServer::serve()
+{
+  const Socket s = toSocket(m_socket);
+
+  while (!m_stop) {
+    // waits a little at a time so the destructor doesn't have to wake it up
+    fd_set set;
+    FD_ZERO(&set);
+    FD_SET(s, &set);
+
+    timeval timeout{0, 20 * 1000};
+    if (select(static_cast<int>(s) + 1, &set, nullptr, nullptr, &timeout) <= 0) {
+      continue;
+    }
+
+    const Socket client = accept(s, nullptr, nullptr);
+    if (client == NO_SOCKET) {
+      continue;
+    }
+
+    handle(static_cast<std::intptr_t>(client));
+    closeSocket(client);
+  }
+}
+
+void HttpServer::handle(std::intptr_t c)
+{
+  const Socket client = toSocket(c);
+
+  // requests from curl are a few hundred bytes of headers without a body
+  std::string data;
+  char buffer[4096];
+
+  while (data.find("\r\n\r\n") == std::string::npos) {
+    const auto n = recv(client, buffer, sizeof(buffer), 0);
+    if (n <= 0) {
+      return;
+    }
+
+    data.append(buffer, static_cast<std::size_t>(n));
+  }
+
+  Request request;
+
+  std::size_t begin = 0;
+  for (bool first = true;; first = false) {
+    const auto end = data.find("\r\n", begin);
+    if (end == begin || end == std::string::npos) {
+      break;
+    }
+
+    const auto line = data.substr(begin, end - begin);
+    begin           = end + 2;
+
+    if (first) {
+      const auto a   = line.find(' ');
+      const auto b   = line.find(' ', a + 1);
+      request.method = line.substr(0, a);
+      request.path   = line.substr(a + 1, b - a - 1);
+      continue;
+    }
+
+    const auto colon = line.find(':');
+    if (colon == std::string::npos) {
+      continue;
+    }
+
+    auto name = line.substr(0, colon);
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char ch) {
+      return static_cast<char>(std::tolower(ch));
+    });
+
+    auto value = line.substr(colon + 1);
+    value.erase(0, value.find_first_not_of(' '));
+
+    request.headers[name] = value;
+  }
+
+  {
+    std::scoped_lock lock(m_mutex);
+    m_requests.push_back(request);
+  }
+
+  const auto response = m_handler(request);
+
+  std::string out = "HTTP/1.1 " + std::to_string(response.status) + " " +
+                    reasonPhrase(response.status) + "\r\n";
+
+  for (const auto& [name, value] : response.headers) {
+    out += name + ": " + value + "\r\n";
+  }
+
+  // a 304 has no body, not even an empty one
+  if (response.status != 304) {
+    out += "Content-Length: " + std::to_string(response.body.size()) + "\r\n";
+  }
+
+  out += "Connection: close\r\n\r\n";
+  out += response.body;
+
+  for (std::size_t sent = 0; sent < out.size();) {
+    const auto n = send(client, out.data() + sent, static_cast<int>(out.size() - sent),
+                        SEND_FLAGS);
+    if (n <= 0) {
+      return;
+    }
+
+    sent += static_cast<std::size_t>(n);
+  }
+}
+
+}  // namespace lootcli::tests
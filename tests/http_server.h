@@ -0,0 +1,81 @@
+#ifndef LOOTCLI_TESTS_HTTP_SERVER_H
+#define LOOTCLI_TESTS_HTTP_SERVER_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace lootcli::tests
+{
+
+// an http/1.1 server on a loopback port that answers every request with what
+// the handler returns, so downloads can be tested without the network
+//
+// requests are handled one at a time on a thread of its own and every
+// connection is closed after its response
+//
+class HttpServer
+{
+public:
+  struct Request
+  {
+    std::string method;
+    std::string path;
+
+    // names are lowercase
+    std::map<std::string, std::string> headers;
+
+    // the value of the header, empty if there's none
+    std::string header(const std::string& name) const;
+  };
+
+  struct Response
+  {
+    int status = 200;
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;
+  };
+
+  using Handler = std::function<Response(const Request&)>;
+
+  // throws if no port can be bound
+  //
+  explicit HttpServer(Handler handler);
+  ~HttpServer();
+
+  HttpServer(const HttpServer&)            = delete;
+  HttpServer& operator=(const HttpServer&) = delete;
+
+  // "http://127.0.0.1:<port>" followed by path
+  //
+  std::string url(std::string_view path) const;
+
+  // the requests received so far, in order
+  //
+  std::vector<Request> requests() const;
+
+private:
+  Handler m_handler;
+  std::intptr_t m_socket;
+  int m_port;
+  std::atomic<bool> m_stop;
+
+  mutable std::mutex m_mutex;
+  std::vector<Request> m_requests;
+
+  std::thread m_thread;
+
+  void serve();
+  void handle(std::intptr_t client);
+};
+
+}  // namespace lootcli::tests
+
+#endif  // LOOTCLI_TESTS_HTTP_SERVER_H
@@ -0,0 +1,117 @@
+#include "corpus.h"
+#include "plugin_index.h"
+#include <gtest/gtest.h>
+#include <boost/locale.hpp>
+#include <map>
+
+namespace fs = std::filesystem;
+
+namespace lootcli::tests
+{
+
+class PluginIndexTest : public testing::Test
+{
+protected:
+  static void SetUpTestSuite()
+  {
+    // the unicode fallback folds with the global locale, like lootcli sets it
+    boost::locale::generator gen;
+    std::locale::global(gen("en.UTF-8"));
+  }
+
+  static void TearDownTestSuite() { std::locale::global(std::locale::classic()); }
+};
+
+TEST_F(PluginIndexTest, FoldsLikeBoostLocale)
+{
+  // lengths around the 16 bytes folded at a time
+  for (std::size_t n = 0; n <= 40; ++n) {
+    std::string s;
+    for (std::size_t i = 0; i < n; ++i) {
+      s += static_cast<char>("AbCxYz@[`{09 .-_"[i % 16]);
+    }
+
+    EXPECT_EQ(foldCase(s), boost::locale::fold_case(s)) << s;
+  }
+
+  // non-ascii anywhere falls back
+  for (const std::string s : {"\xc3\x84pfel.esp",
+                              "Sch\xc3\xb6ne Stra\xc3\x9f"
+                              "e.esm",
+                              "A Long Name Before Anything Else \xc3\x89.esp",
+                              "\xce\xa3\xce\x99\xce\xa3.esp"}) {
+    EXPECT_EQ(foldCase(s), boost::locale::fold_case(s)) << s;
+  }
+}
+
+// every lookup the report makes must find the same plugin as libloot's
+// GetPlugin() and as a map of the case-folded names, which is what the
+// report did before the index
+//
+TEST_F(PluginIndexTest, FindsTheSamePluginsAsLibloot)
+{
+  const auto root = fs::temp_directory_path() / "lootcli_tests" / "plugin_index";
+  fs::remove_all(root);
+
+  CorpusOptions co;
+  co.plugins = 400;
+  co.seed    = 5;
+
+  const auto c = generateCorpus(root, co);
+
+  const loot::GameSettings settings(co.game);
+  auto game = loot::CreateGameHandle(settings.Type(), c.gamePath, c.profilePath);
+
+  std::vector<fs::path> files;
+  for (const auto& e : fs::directory_iterator(loot::GetDataPath(co.game, c.gamePath))) {
+    files.push_back(e.path().filename());
+  }
+
+  game->LoadPlugins(files, true);
+
+  const auto plugins = game->GetLoadedPlugins();
+  ASSERT_EQ(plugins.size(), files.size());
+
+  std::map<std::string, const loot::PluginInterface*> folded;
+  for (const auto& p : plugins) {
+    folded.emplace(boost::locale::fold_case(p->GetName()), p.get());
+  }
+
+  const PluginIndex index(plugins);
+
+  auto expectSame = [&](const std::string& name) {
+    const auto itor     = folded.find(boost::locale::fold_case(name));
+    const auto expected = (itor == folded.end() ? nullptr : itor->second);
+
+    EXPECT_EQ(index.find(name), expected) << name;
+    EXPECT_EQ(index.find(name), game->GetPlugin(name).get()) << name;
+  };
+
+  for (const auto& p : plugins) {
+    const auto name = p->GetName();
+
+    expectSame(name);
+    expectSame(boost::locale::to_upper(name));
+    expectSame(boost::locale::to_lower(name));
+
+    // includes masters that aren't installed
+    for (const auto& m : p->GetMasters()) {
+      expectSame(m);
+    }
+
+    expectSame(name + " ");
+    expectSame(name.substr(0, name.size() - 1));
+  }
+
+  expectSame("");
+  expectSame("Missing.esp");
+  expectSame("\xc3\x84pfel.esp");
+  expectSame(std::string(300, 'A') + ".esp");
+
+  game.reset();
+
+  std::error_code ec;
+  fs::remove_all(root, ec);
+}
+
+}  // namespace lootcli::tests
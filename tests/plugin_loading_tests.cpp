@@ -0,0 +1,113 @@
+#include "corpus.h"
+#include "lootthread.h"
+#include <gtest/gtest.h>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace lootcli::tests
+{
+
+// generates the same corpus in root every time, sorts it with the given number
+// of threads and returns the sorted load order file; the lines the worker
+// wrote go in output when given
+//
+std::string sortCorpus(const fs::path& root, unsigned int threads,
+                       std::string* output = nullptr)
+{
+  CorpusOptions co;
+  co.plugins = 600;
+  co.seed    = 7;
+
+  const auto c = generateCorpus(root, co);
+
+  LOOTWorker worker;
+  worker.setGame("skyrimse");
+  worker.setGamePath(c.gamePath.string());
+  worker.setPluginListPath((c.profilePath / "loadorder.txt").string());
+  worker.setOutput((c.profilePath / "report.json").string());
+  worker.setLootDataPath(c.lootDataPath.string());
+  worker.setLanguageCode("en");
+  worker.setLogLevel(loot::LogLevel::error);
+  worker.setUpdateMasterlist(false);
+  worker.setThreads(threads);
+
+  if (output) {
+    testing::internal::CaptureStdout();
+  }
+
+  const auto result = worker.run();
+
+  if (output) {
+    *output = testing::internal::GetCapturedStdout();
+  }
+
+  if (result != 0) {
+    throw std::runtime_error("sorting the corpus in " + root.string() + " failed");
+  }
+
+  std::ifstream in(c.profilePath / "loadorder.txt", std::ios::binary);
+  return {std::istreambuf_iterator<char>(in), {}};
+}
+
+// threads build the report and sort batches, the sorted order can't depend
+// on how many there are
+//
+TEST(PluginLoadingTest, ThreadsDontChangeTheSortedOrder)
+{
+  const auto root = fs::temp_directory_path() / "lootcli_tests" / "loading";
+  fs::remove_all(root);
+
+  const auto single = sortCorpus(root / "single", 1);
+  ASSERT_FALSE(single.empty());
+
+  for (const unsigned int threads : {2u, 3u, 8u}) {
+    EXPECT_EQ(sortCorpus(root / ("threads-" + std::to_string(threads)), threads),
+              single)
+        << threads << " threads";
+  }
+
+  std::error_code ec;
+  fs::remove_all(root, ec);
+}
+
+// the plugins are loaded in batches so their progress moves during the
+// phase, also when everything else runs on one thread
+//
+TEST(PluginLoadingTest, ReportsProgressWhileReadingPlugins)
+{
+  const auto root = fs::temp_directory_path() / "lootcli_tests" / "loading-progress";
+  fs::remove_all(root);
+
+  std::string output;
+  sortCorpus(root, 1, &output);
+
+  std::istringstream in(output);
+  std::string line;
+  std::vector<ItemProgress> items;
+
+  while (std::getline(in, line)) {
+    const auto m = parseMessageView(line);
+    if (m.type == MessageType::Progress && m.progress == Progress::ReadingPlugins &&
+        m.items) {
+      items.push_back(*m.items);
+    }
+  }
+
+  ASSERT_GT(items.size(), 1);
+  EXPECT_LT(items.front().done, items.front().total);
+  EXPECT_GT(items.front().bytes, 0);
+  EXPECT_EQ(items.back().done, items.back().total);
+
+  for (std::size_t i = 1; i < items.size(); ++i) {
+    EXPECT_GT(items[i].done, items[i - 1].done);
+    EXPECT_GT(items[i].bytes, items[i - 1].bytes);
+  }
+
+  std::error_code ec;
+  fs::remove_all(root, ec);
+}
+
+}  // namespace lootcli::tests
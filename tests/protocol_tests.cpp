@@ -0,0 +1,119 @@
+#include "regex_parser.h"
+#include <lootcli/lootcli.h>
+#include <gtest/gtest.h>
+#include <random>
+
+namespace lootcli::tests
+{
+
+void expectSameAsRegex(const std::string& line)
+{
+  const auto expected = parseMessageWithRegex(line);
+  const auto m        = parseMessage(line);
+
+  EXPECT_EQ(m.type, expected.type) << line;
+  EXPECT_EQ(m.progress, expected.progress) << line;
+  EXPECT_EQ(m.logLevel, expected.logLevel) << line;
+  EXPECT_EQ(m.log, expected.log) << line;
+  EXPECT_EQ(m.exitCode, expected.exitCode) << line;
+}
+
+TEST(ProtocolTest, ParsesLikeTheRegex)
+{
+  for (const std::string line : {
+           "",
+           "[",
+           "[]",
+           "[] text",
+           "[info]",
+           "[info] ",
+           "[info]  ",
+           "[info] text",
+           "[info]text",
+           "[Info] text",
+           "[in fo] text",
+           "[info] [debug] text",
+           "[info] line\nbreak",
+           "[info] line\rbreak",
+           "[info] text\n",
+           " [info] text",
+           "[unknown] text",
+           "[trace] text",
+           "[debug] text",
+           "[warning] text",
+           "[error] text",
+           "[progress] 4",
+           "[progress] 4 10/20 300 400",
+           "[progress] +4",
+           "[progress] -4",
+           "[progress]  \t4x",
+           "[progress] +-4",
+           "[progress] x",
+           "[progress] 2147483647",
+           "[progress] 2147483648",
+           "[progress] -2147483649",
+           "[exit] 0",
+           "[exit] 1 trailing",
+           "[exit] ",
+           "[exit] -",
+           "[exit] 99999999999",
+       }) {
+    expectSameAsRegex(line);
+  }
+}
+
+// lines made of the tokens the parsers look at, in any order
+//
+TEST(ProtocolTest, ParsesRandomLinesLikeTheRegex)
+{
+  const std::string tokens[] = {
+      "[",     "]",        " ",    "\t",   "\n",   "\r",         "progress",
+      "exit",  "info",     "warn", "x",    "Z",    "0",          "42",
+      "+",     "-",        "/",    "[info] ",      "[progress] ", "[exit] ",
+      "9999999999",        "\xc3\xa9"};
+
+  std::mt19937 rng(11);
+
+  for (int i = 0; i < 100000; ++i) {
+    std::string line;
+
+    for (auto n = rng() % 8; n > 0; --n) {
+      line += tokens[rng() % std::size(tokens)];
+    }
+
+    expectSameAsRegex(line);
+
+    if (HasFailure()) {
+      break;
+    }
+  }
+}
+
+TEST(ProtocolTest, ViewPointsIntoTheLine)
+{
+  const std::string line = "[debug] some text";
+  const auto m           = parseMessageView(line);
+
+  EXPECT_EQ(m.type, MessageType::Log);
+  EXPECT_EQ(m.logLevel, LogLevels::Debug);
+  EXPECT_EQ(m.log.data(), line.data() + 8);
+  EXPECT_EQ(m.log, "some text");
+}
+
+TEST(ProtocolTest, ParsesItemProgress)
+{
+  const auto m = parseMessageView("[progress] 4 10/20 300 400");
+
+  ASSERT_EQ(m.type, MessageType::Progress);
+  EXPECT_EQ(m.progress, Progress::ReadingPlugins);
+  ASSERT_TRUE(m.items);
+  EXPECT_EQ(m.items->done, 10);
+  EXPECT_EQ(m.items->total, 20);
+  EXPECT_EQ(m.items->bytes, 300);
+  EXPECT_EQ(m.items->etaMilliseconds, 400);
+
+  EXPECT_FALSE(parseMessageView("[progress] 4 10/20 300").items);
+  EXPECT_FALSE(parseMessageView("[progress] 4 10/20 300 400 ").items);
+}
+
+}  // namespace lootcli::tests
@@ -0,0 +1,47 @@
+#ifndef LOOTCLI_TESTS_REGEX_PARSER_H
+#define LOOTCLI_TESTS_REGEX_PARSER_H
+
+#include <lootcli/lootcli.h>
+#include <regex>
+#include <string>
+#include <string_view>
+
+namespace lootcli::tests
+{
+
+// the regex parser lootcli.h had before parseMessageView(), without item
+// progress; kept to compare against in the protocol tests and the "protocol"
+// bench case
+//
+inline Message parseMessageWithRegex(std::string_view line)
+{
+  static const std::regex e(R"(^\[([a-z]+)\] (.+)$)");
+
+  std::match_results<std::string_view::const_iterator> m;
+  if (!std::regex_match(line.begin(), line.end(), m, e)) {
+    return {};
+  }
+
+  const auto type = m[1];
+
+  if (type == "progress") {
+    try {
+      const auto p = std::stoi(m[2]);
+      return Message::fromProgress(static_cast<Progress>(p));
+    } catch (std::exception&) {
+      return {};
+    }
+  } else if (type == "exit") {
+    try {
+      return Message::fromExit(std::stoi(m[2]));
+    } catch (std::exception&) {
+      return {};
+    }
+  } else {
+    return Message::fromLog(logLevelFromString(type.str()), m[2]);
+  }
+}
+
+}  // namespace lootcli::tests
+
+#endif  // LOOTCLI_TESTS_REGEX_PARSER_H
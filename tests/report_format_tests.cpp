@@ -0,0 +1,500 @@
+#include "cbor_writer.h"
+#include "corpus.h"
+#include "json_writer.h"
+#include "lootthread.h"
+#include "message_cache.h"
+#include <gtest/gtest.h>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace lootcli::tests
+{
+
+// writes a document with every kind of value, keys are sorted like
+// QJsonDocument sorts them
+//
+void writeSample(ReportWriter& w)
+{
+  w.beginDocument();
+  w.beginObject();
+
+  w.key("array");
+  w.beginArray();
+  w.value(std::int64_t(1));
+  w.value(std::int64_t(-2));
+  w.value(std::int64_t(4294967296));
+  w.value(true);
+  w.value(false);
+  w.value("s");
+  w.beginObject();
+  w.endObject();
+  w.beginArray();
+  w.endArray();
+  w.endArray();
+
+  w.member("empty string", "");
+
+  w.key("emptyArray");
+  w.beginArray();
+  w.endArray();
+
+  w.key("emptyObject");
+  w.beginObject();
+  w.endObject();
+
+  w.member("escapes", "quote \" backslash \\ slash / \b\f\n\r\t \x01\x1f end");
+
+  w.key("nested");
+  w.beginObject();
+  w.key("a");
+  w.beginArray();
+  w.beginObject();
+  w.member("b", "c");
+  w.member("d", std::int64_t(0));
+  w.endObject();
+  w.endArray();
+  w.endObject();
+
+  w.member("unicode", "\xc3\xa9 \xe4\xb8\xad \xf0\x9f\x98\x80");
+
+  w.endObject();
+  w.endDocument();
+}
+
+std::string throughQt(const std::string& json, QJsonDocument::JsonFormat format)
+{
+  const auto doc = QJsonDocument::fromJson(QByteArray::fromStdString(json));
+  return doc.toJson(format).toStdString();
+}
+
+// the indented report must stay byte for byte what QJsonDocument wrote before
+// the report was written directly
+//
+TEST(JsonWriterTest, IndentedIsTheSameAsQJsonDocument)
+{
+  std::string out;
+  JsonWriter w(out);
+  writeSample(w);
+
+  EXPECT_EQ(out, throughQt(out, QJsonDocument::Indented));
+}
+
+TEST(JsonWriterTest, CompactIsTheSameAsQJsonDocument)
+{
+  std::string out;
+  JsonWriter w(out, 0, true);
+  writeSample(w);
+
+  EXPECT_EQ(out, throughQt(out, QJsonDocument::Compact));
+}
+
+// a value written separately at the depth of the member it's pasted in must
+// give the same document as writing it in place
+//
+TEST(JsonWriterTest, RawValueIsIndentedLikeTheDocument)
+{
+  std::string value;
+  JsonWriter v(value, 1);
+  v.beginObject();
+  v.member("b", "c");
+  v.endObject();
+
+  std::string pasted;
+  JsonWriter p(pasted);
+  p.beginDocument();
+  p.beginObject();
+  p.key("a");
+  p.raw(value);
+  p.endObject();
+  p.endDocument();
+
+  std::string direct;
+  JsonWriter d(direct);
+  d.beginDocument();
+  d.beginObject();
+  d.key("a");
+  d.beginObject();
+  d.member("b", "c");
+  d.endObject();
+  d.endObject();
+  d.endDocument();
+
+  EXPECT_EQ(pasted, direct);
+  EXPECT_EQ(pasted, throughQt(pasted, QJsonDocument::Indented));
+}
+
+// reads a json report into the same structs as decodeCborReport(), the way a
+// consumer of the json report would
+//
+Report decodeJsonReport(const std::string& json)
+{
+  const auto root = QJsonDocument::fromJson(QByteArray::fromStdString(json)).object();
+
+  auto str = [](const QJsonValue& v) {
+    return v.toString().toStdString();
+  };
+
+  auto message = [&](const QJsonValue& v) {
+    const auto o = v.toObject();
+    return ReportMessage{str(o["type"]), str(o["text"])};
+  };
+
+  auto cleaning = [&](const QJsonValue& v) {
+    const auto o = v.toObject();
+
+    ReportCleaningData d;
+    d.crc               = o["crc"].toInteger();
+    d.itm               = o["itm"].toInteger();
+    d.deletedReferences = o["deletedReferences"].toInteger();
+    d.deletedNavmesh    = o["deletedNavmesh"].toInteger();
+    d.cleaningUtility   = str(o["cleaningUtility"]);
+    d.info              = str(o["info"]);
+
+    return d;
+  };
+
+  Report r;
+
+  for (const auto& m : root["messages"].toArray()) {
+    r.messages.push_back(message(m));
+  }
+
+  for (const auto& v : root["plugins"].toArray()) {
+    const auto o = v.toObject();
+
+    ReportPlugin p;
+    p.name          = str(o["name"]);
+    p.loadsArchive  = o["loadsArchive"].toBool();
+    p.isMaster      = o["isMaster"].toBool();
+    p.isLightMaster = o["isLightMaster"].toBool();
+
+    for (const auto& i : o["incompatibilities"].toArray()) {
+      const auto io   = i.toObject();
+      const auto name = str(io["name"]);
+      p.incompatibilities.push_back(
+          {name, io.contains("displayName") ? str(io["displayName"]) : name});
+    }
+
+    for (const auto& m : o["messages"].toArray()) {
+      p.messages.push_back(message(m));
+    }
+
+    for (const auto& d : o["dirty"].toArray()) {
+      p.dirty.push_back(cleaning(d));
+    }
+
+    for (const auto& d : o["clean"].toArray()) {
+      p.clean.push_back(cleaning(d));
+    }
+
+    for (const auto& m : o["missingMasters"].toArray()) {
+      p.missingMasters.push_back(str(m));
+    }
+
+    r.plugins.push_back(std::move(p));
+  }
+
+  const auto stats = root["stats"].toObject();
+  r.stats.loadOrderChanged = stats["loadOrderChanged"].toBool();
+  r.stats.lootcliVersion   = str(stats["lootcliVersion"]);
+  r.stats.lootVersion      = str(stats["lootVersion"]);
+
+  return r;
+}
+
+// one line per value, so a difference shows where it is; times and phases
+// differ from run to run and are left out
+//
+std::string dump(const Report& r)
+{
+  std::ostringstream ss;
+
+  auto messages = [&](const std::vector<ReportMessage>& v) {
+    for (const auto& m : v) {
+      ss << "  message " << m.type << " " << m.text << "\n";
+    }
+  };
+
+  auto cleaning = [&](const char* what, const std::vector<ReportCleaningData>& v) {
+    for (const auto& d : v) {
+      ss << "  " << what << " " << d.crc << " " << d.itm << " " << d.deletedReferences
+         << " " << d.deletedNavmesh << " " << d.cleaningUtility << " " << d.info
+         << "\n";
+    }
+  };
+
+  messages(r.messages);
+
+  for (const auto& p : r.plugins) {
+    ss << "plugin " << p.name << " " << p.loadsArchive << p.isMaster
+       << p.isLightMaster << "\n";
+
+    for (const auto& i : p.incompatibilities) {
+      ss << "  incompatible " << i.name << " " << i.displayName << "\n";
+    }
+
+    messages(p.messages);
+    cleaning("dirty", p.dirty);
+    cleaning("clean", p.clean);
+
+    for (const auto& m : p.missingMasters) {
+      ss << "  missing " << m << "\n";
+    }
+  }
+
+  ss << "stats " << r.stats.loadOrderChanged << " " << r.stats.lootcliVersion << " "
+     << r.stats.lootVersion << "\n";
+
+  return ss.str();
+}
+
+// sorts the corpus in root with the given report format and returns the
+// report
+//
+std::string sortWithFormat(const fs::path& root, ReportFormat format, bool table)
+{
+  CorpusOptions co;
+  co.plugins = 300;
+  co.seed    = 3;
+
+  const auto c   = generateCorpus(root, co);
+  const auto out = c.profilePath / "report";
+
+  LOOTWorker worker;
+  worker.setGame("skyrimse");
+  worker.setGamePath(c.gamePath.string());
+  worker.setPluginListPath((c.profilePath / "loadorder.txt").string());
+  worker.setOutput(out.string());
+  worker.setLootDataPath(c.lootDataPath.string());
+  worker.setLanguageCode("en");
+  worker.setLogLevel(loot::LogLevel::error);
+  worker.setUpdateMasterlist(false);
+  worker.setReportFormat(format);
+  worker.setMessageTable(table);
+
+  if (worker.run() != 0) {
+    throw std::runtime_error("sorting the corpus in " + root.string() + " failed");
+  }
+
+  std::ifstream in(out, std::ios::binary);
+  return {std::istreambuf_iterator<char>(in), {}};
+}
+
+// cbor mirrors the json report, also when the messages are in a table
+//
+TEST(ReportFormatTest, CborHasTheSameContentAsJson)
+{
+  const auto root = fs::temp_directory_path() / "lootcli_tests" / "formats";
+  fs::remove_all(root);
+
+  const auto json =
+      decodeJsonReport(sortWithFormat(root / "json", ReportFormat::Json, false));
+  ASSERT_FALSE(json.plugins.empty());
+
+  const auto compact = decodeJsonReport(
+      sortWithFormat(root / "compact", ReportFormat::JsonCompact, false));
+  EXPECT_EQ(dump(compact), dump(json));
+
+  for (const bool table : {false, true}) {
+    const auto cbor = decodeCborReport(sortWithFormat(
+        root / ("cbor-" + std::to_string(table)), ReportFormat::Cbor, table));
+
+    EXPECT_EQ(dump(cbor), dump(json)) << (table ? "with" : "without") << " a table";
+    EXPECT_FALSE(cbor.stats.phases.empty());
+  }
+
+  std::error_code ec;
+  fs::remove_all(root, ec);
+}
+
+// a job of a batch gets the report a single sort of its profile writes, in
+// both the metadata conditions see the load order from before the sort
+//
+TEST(ReportFormatTest, BatchJobHasTheSameReportAsASingleSort)
+{
+  const auto root = fs::temp_directory_path() / "lootcli_tests" / "batch-report";
+  fs::remove_all(root);
+
+  CorpusOptions co;
+  co.plugins = 300;
+  co.seed    = 3;
+
+  const auto c = generateCorpus(root / "corpus", co);
+
+  auto read = [](const fs::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), {});
+  };
+
+  auto profile = [&](const std::string& name, const std::string& pluginsTxt) {
+    const auto p = root / name;
+    fs::create_directories(p);
+    std::ofstream(p / "plugins.txt", std::ios::binary) << pluginsTxt;
+    return p;
+  };
+
+  const auto pluginsTxt = read(c.profilePath / "plugins.txt");
+  const auto single     = profile("single", pluginsTxt);
+  const auto batch      = profile("batch", pluginsTxt);
+
+  // another load order without the last plugin, so the batch sorts two
+  // groups on two handles
+  const auto last  = pluginsTxt.rfind('\n', pluginsTxt.size() - 2);
+  const auto other = profile("other", pluginsTxt.substr(0, last + 1));
+
+  auto configure = [&](LOOTWorker& worker) {
+    worker.setGame("skyrimse");
+    worker.setGamePath(c.gamePath.string());
+    worker.setLootDataPath(c.lootDataPath.string());
+    worker.setLanguageCode("en");
+    worker.setLogLevel(loot::LogLevel::error);
+    worker.setUpdateMasterlist(false);
+    worker.setReportFormat(ReportFormat::Cbor);
+    worker.setThreads(2);
+  };
+
+  LOOTWorker singleWorker;
+  configure(singleWorker);
+  singleWorker.setPluginListPath((single / "loadorder.txt").string());
+  singleWorker.setOutput((single / "report").string());
+  ASSERT_EQ(singleWorker.run(), 0);
+
+  LOOTWorker batchWorker;
+  configure(batchWorker);
+  ASSERT_EQ(batchWorker.runBatch(
+                {{(batch / "loadorder.txt").string(), (batch / "report").string()},
+                 {(other / "loadorder.txt").string(), (other / "report").string()}}),
+            0);
+
+  EXPECT_EQ(read(batch / "loadorder.txt"), read(single / "loadorder.txt"));
+
+  const auto expected = decodeCborReport(read(single / "report"));
+  ASSERT_FALSE(expected.plugins.empty());
+  EXPECT_EQ(dump(decodeCborReport(read(batch / "report"))), dump(expected));
+
+  std::error_code ec;
+  fs::remove_all(root, ec);
+}
+
+// the same document written by both writers decodes to the same values
+//
+TEST(ReportFormatTest, CborWriterMatchesJsonWriter)
+{
+  auto write = [](ReportWriter& w) {
+    w.beginDocument();
+    w.beginObject();
+
+    w.key("messages");
+    w.beginArray();
+    w.beginObject();
+    w.member("text", "general \"message\"\n\xc3\xa9");
+    w.member("type", "warn");
+    w.endObject();
+    w.endArray();
+
+    w.key("plugins");
+    w.beginArray();
+    w.beginObject();
+
+    w.key("dirty");
+    w.beginArray();
+    w.beginObject();
+    w.member("cleaningUtility", "SSEEdit");
+    w.member("crc", std::int64_t(0xdeadbeef));
+    w.member("deletedNavmesh", std::int64_t(2));
+    w.member("deletedReferences", std::int64_t(300));
+    w.member("info", "clean it");
+    w.member("itm", std::int64_t(70000));
+    w.endObject();
+    w.endArray();
+
+    w.key("incompatibilities");
+    w.beginArray();
+    w.beginObject();
+    w.member("displayName", "Other Plugin");
+    w.member("name", "other.esp");
+    w.endObject();
+    w.beginObject();
+    w.member("name", "third.esp");
+    w.endObject();
+    w.endArray();
+
+    w.member("isMaster", true);
+
+    w.key("missingMasters");
+    w.beginArray();
+    w.value("missing.esm");
+    w.endArray();
+
+    w.member("name", "plugin.esp");
+    w.endObject();
+    w.endArray();
+
+    w.key("stats");
+    w.beginObject();
+    w.member("loadOrderChanged", true);
+    w.member("lootVersion", "0.1");
+    w.member("lootcliVersion", "1.2");
+    w.endObject();
+
+    w.endObject();
+    w.endDocument();
+  };
+
+  std::string json, cbor;
+
+  JsonWriter jw(json);
+  write(jw);
+
+  CborWriter cw(cbor);
+  write(cw);
+
+  const auto fromJson = decodeJsonReport(json);
+  ASSERT_EQ(fromJson.plugins.size(), 1);
+  EXPECT_EQ(fromJson.plugins[0].dirty.at(0).crc, 0xdeadbeef);
+
+  EXPECT_EQ(dump(decodeCborReport(cbor)), dump(fromJson));
+}
+
+// inserting a message must not change the ids of the others, or a delta
+// would show every plugin with a message after it as changed
+//
+TEST(MessageTableTest, IdsDontDependOnOtherMessages)
+{
+  auto content = [](std::string_view text) {
+    return std::vector<loot::MessageContent>{loot::MessageContent(text, "en")};
+  };
+
+  MessageCache before("en");
+  const auto a = before.resolve(loot::MessageType::say, content("a")).id;
+  const auto b = before.resolve(loot::MessageType::warn, content("b")).id;
+
+  MessageCache after("en");
+  after.resolve(loot::MessageType::error, content("inserted"));
+
+  EXPECT_EQ(after.resolve(loot::MessageType::warn, content("b")).id, b);
+  EXPECT_EQ(after.resolve(loot::MessageType::say, content("a")).id, a);
+
+  // the type is part of the message
+  EXPECT_NE(after.resolve(loot::MessageType::warn, content("a")).id, a);
+
+  // other languages aren't reported, the message is written once
+  auto translated = content("a");
+  translated.emplace_back("x", "de");
+  EXPECT_EQ(after.resolve(loot::MessageType::say, translated).id, a);
+
+  const auto table = after.table();
+  ASSERT_EQ(table.size(), 4);
+
+  for (std::size_t i = 1; i < table.size(); ++i) {
+    EXPECT_LT(table[i - 1]->id, table[i]->id);
+  }
+}
+
+}  // namespace lootcli::tests